@@ -0,0 +1,298 @@
+/* Dark variant benchmark
+ *
+ * Compares the two ways an application that already shows the light
+ * Adwaita theme can switch to the dark one: parsing the full dark
+ * stylesheet, or parsing only gtk-main-dark-delta.css on top of the
+ * light one. For each, the parse time and the heap retained by the
+ * parsed stylesheets are reported, as well as the time and heap used
+ * to resolve the style of a set of common widget paths in a few
+ * states, which is what fills the style caches.
+ *
+ * Every setup is measured in its own process, so that the numbers
+ * don't include caches or memory from the previous one. The digest of
+ * the resolved values is printed too: the dark and light+delta setups
+ * should give the same one.
+ */
+
+#include <gtk/gtk.h>
+#include <malloc.h>
+#include <string.h>
+
+#define RESOURCE_PREFIX "resource:///org/gnome/adwaita/"
+
+typedef struct {
+  const gchar *name;
+  const gchar *base;
+  const gchar *stylesheet;
+} Setup;
+
+static const Setup setups[] = {
+  { "light", NULL, "gtk-main.css" },
+  { "dark", NULL, "gtk-main-dark.css" },
+  { "light+delta", "gtk-main.css", "gtk-main-dark-delta.css" }
+};
+
+static const struct {
+  GType (* get_type) (void);
+  const gchar *style_class;
+} widgets[] = {
+  { gtk_button_get_type, GTK_STYLE_CLASS_BUTTON },
+  { gtk_toggle_button_get_type, GTK_STYLE_CLASS_BUTTON },
+  { gtk_check_button_get_type, GTK_STYLE_CLASS_CHECK },
+  { gtk_radio_button_get_type, GTK_STYLE_CLASS_RADIO },
+  { gtk_entry_get_type, GTK_STYLE_CLASS_ENTRY },
+  { gtk_spin_button_get_type, GTK_STYLE_CLASS_SPINBUTTON },
+  { gtk_toolbar_get_type, GTK_STYLE_CLASS_PRIMARY_TOOLBAR },
+  { gtk_menu_bar_get_type, GTK_STYLE_CLASS_MENUBAR },
+  { gtk_menu_item_get_type, GTK_STYLE_CLASS_MENUITEM },
+  { gtk_notebook_get_type, GTK_STYLE_CLASS_NOTEBOOK },
+  { gtk_scale_get_type, GTK_STYLE_CLASS_SLIDER },
+  { gtk_scrollbar_get_type, GTK_STYLE_CLASS_TROUGH },
+  { gtk_progress_bar_get_type, GTK_STYLE_CLASS_PROGRESSBAR },
+  { gtk_switch_get_type, GTK_STYLE_CLASS_SLIDER },
+  { gtk_tree_view_get_type, GTK_STYLE_CLASS_VIEW },
+  { gtk_frame_get_type, GTK_STYLE_CLASS_FRAME }
+};
+
+static const GtkStateFlags states[] = {
+  GTK_STATE_FLAG_NORMAL,
+  GTK_STATE_FLAG_PRELIGHT,
+  GTK_STATE_FLAG_ACTIVE,
+  GTK_STATE_FLAG_INSENSITIVE,
+  GTK_STATE_FLAG_SELECTED,
+  GTK_STATE_FLAG_BACKDROP
+};
+
+static gint iterations = 20;
+static gchar *child = NULL;
+
+static GOptionEntry entries[] = {
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of times to parse the stylesheet", "N" },
+  { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &child,
+    NULL, NULL },
+  { NULL }
+};
+
+static gsize
+get_heap_size (void)
+{
+  return mallinfo ().uordblks;
+}
+
+static GtkCssProvider *
+load_stylesheet (const gchar *name)
+{
+  GtkCssProvider *provider;
+  GError *error = NULL;
+  GFile *file;
+  gchar *uri;
+
+  uri = g_strconcat (RESOURCE_PREFIX, name, NULL);
+  file = g_file_new_for_uri (uri);
+  provider = gtk_css_provider_new ();
+
+  if (!gtk_css_provider_load_from_file (provider, file, &error))
+    g_error ("Unable to load %s: %s", uri, error->message);
+
+  g_object_unref (file);
+  g_free (uri);
+
+  return provider;
+}
+
+static void
+run_setup (const Setup *setup)
+{
+  GtkCssProvider *base = NULL, *provider = NULL;
+  GtkStyleContext **contexts;
+  GtkWidgetPath *path;
+  GResource *resource;
+  GError *error = NULL;
+  GTimer *timer;
+  GdkRGBA color;
+  GtkBorder border;
+  GString *values;
+  gchar *str;
+  gdouble parse_time = 0, resolve_time;
+  gsize heap, parse_heap = 0, resolve_heap;
+  gint i, j;
+
+  /* keep the installed theme out of the measurements */
+  g_object_set (gtk_settings_get_default (),
+                "gtk-theme-name", "Raleigh",
+                NULL);
+
+  resource = g_resource_load (THEMES_BUILDDIR "/Adwaita/gtk-3.0/gtk.gresource", &error);
+  if (resource == NULL)
+    g_error ("Unable to load the Adwaita resources: %s", error->message);
+
+  g_resources_register (resource);
+
+  /* the light theme is already there when switching */
+  if (setup->base != NULL)
+    base = load_stylesheet (setup->base);
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < iterations; i++)
+    {
+      if (provider != NULL)
+        g_object_unref (provider);
+
+      heap = get_heap_size ();
+      g_timer_start (timer);
+      provider = load_stylesheet (setup->stylesheet);
+      parse_time += g_timer_elapsed (timer, NULL);
+      parse_heap = get_heap_size () - heap;
+    }
+
+  contexts = g_new (GtkStyleContext *, G_N_ELEMENTS (widgets));
+  values = g_string_new (NULL);
+  heap = get_heap_size ();
+  g_timer_start (timer);
+
+  for (i = 0; i < G_N_ELEMENTS (widgets); i++)
+    {
+      path = gtk_widget_path_new ();
+      gtk_widget_path_append_type (path, GTK_TYPE_WINDOW);
+      gtk_widget_path_append_type (path, widgets[i].get_type ());
+      gtk_widget_path_iter_add_class (path, -1, widgets[i].style_class);
+
+      contexts[i] = gtk_style_context_new ();
+      gtk_style_context_set_path (contexts[i], path);
+      gtk_widget_path_free (path);
+
+      if (base != NULL)
+        gtk_style_context_add_provider (contexts[i], GTK_STYLE_PROVIDER (base),
+                                        GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+      gtk_style_context_add_provider (contexts[i], GTK_STYLE_PROVIDER (provider),
+                                      GTK_STYLE_PROVIDER_PRIORITY_APPLICATION + 1);
+
+      for (j = 0; j < G_N_ELEMENTS (states); j++)
+        {
+          gtk_style_context_get_color (contexts[i], states[j], &color);
+          gtk_style_context_get_background_color (contexts[i], states[j], &color);
+          gtk_style_context_get_border_color (contexts[i], states[j], &color);
+          gtk_style_context_get_border (contexts[i], states[j], &border);
+        }
+    }
+
+  resolve_time = g_timer_elapsed (timer, NULL);
+  resolve_heap = get_heap_size () - heap;
+
+  /* outside of the timing, so that it doesn't add to it */
+  for (i = 0; i < G_N_ELEMENTS (widgets); i++)
+    for (j = 0; j < G_N_ELEMENTS (states); j++)
+      {
+        gtk_style_context_get_color (contexts[i], states[j], &color);
+        str = gdk_rgba_to_string (&color);
+        g_string_append (values, str);
+        g_free (str);
+
+        gtk_style_context_get_background_color (contexts[i], states[j], &color);
+        str = gdk_rgba_to_string (&color);
+        g_string_append (values, str);
+        g_free (str);
+
+        gtk_style_context_get_border_color (contexts[i], states[j], &color);
+        str = gdk_rgba_to_string (&color);
+        g_string_append (values, str);
+        g_free (str);
+
+        gtk_style_context_get_border (contexts[i], states[j], &border);
+        g_string_append_printf (values, "%d %d %d %d;",
+                                border.top, border.right, border.bottom, border.left);
+      }
+
+  g_print ("%-12s %10.2f %12" G_GSIZE_FORMAT " %10.2f %12" G_GSIZE_FORMAT " %08x\n",
+           setup->name,
+           1000.0 * parse_time / iterations,
+           parse_heap / 1024,
+           1000.0 * resolve_time,
+           resolve_heap / 1024,
+           g_str_hash (values->str));
+
+  g_string_free (values, TRUE);
+
+  for (i = 0; i < G_N_ELEMENTS (widgets); i++)
+    g_object_unref (contexts[i]);
+
+  g_free (contexts);
+  g_timer_destroy (timer);
+  g_object_unref (provider);
+
+  if (base != NULL)
+    g_object_unref (base);
+}
+
+static void
+spawn_setup (const gchar *program,
+             const Setup *setup)
+{
+  GError *error = NULL;
+  gchar *args[5];
+
+  args[0] = (gchar *) program;
+  args[1] = g_strdup_printf ("--iterations=%d", iterations);
+  args[2] = "--child";
+  args[3] = (gchar *) setup->name;
+  args[4] = NULL;
+
+  /* the child shares our stdout */
+  fflush (stdout);
+
+  if (!g_spawn_sync (NULL, args, NULL, G_SPAWN_SEARCH_PATH,
+                     NULL, NULL, NULL, NULL, NULL, &error))
+    {
+      g_printerr ("Unable to run the benchmark for %s: %s\n",
+                  setup->name, error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (args[1]);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gint i;
+
+  context = g_option_context_new ("- compare loading the full dark stylesheet with the delta");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+  iterations = MAX (iterations, 1);
+
+  if (child != NULL)
+    {
+      for (i = 0; i < G_N_ELEMENTS (setups); i++)
+        if (strcmp (setups[i].name, child) == 0)
+          run_setup (&setups[i]);
+
+      return 0;
+    }
+
+  g_print ("parse: mean of %d runs in ms and heap retained by the stylesheet in kB\n"
+           "resolve: %d widget paths in %d states, in ms and heap in kB\n",
+           iterations,
+           (gint) G_N_ELEMENTS (widgets), (gint) G_N_ELEMENTS (states));
+  g_print ("%-12s %10s %12s %10s %12s %8s\n",
+           "setup", "parse", "parse-heap", "resolve", "resolve-heap", "digest");
+
+  for (i = 0; i < G_N_ELEMENTS (setups); i++)
+    spawn_setup (argv[0], &setups[i]);
+
+  return 0;
+}
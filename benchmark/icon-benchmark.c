@@ -0,0 +1,248 @@
+/* Icon theme lookup benchmark
+ *
+ * Times gtk_icon_theme_lookup_icon() for a list of commonly used icons
+ * in an installed icon theme, both on a freshly created GtkIconTheme
+ * (cold) and on one that already served the same lookups (warm). The
+ * same theme is then measured without its icon-theme.cache, through a
+ * mirror of the theme made of symlinks to everything but the cache.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const gchar *icon_names[] = {
+  "document-new", "document-open", "document-save", "document-print",
+  "edit-copy", "edit-cut", "edit-paste", "edit-undo", "edit-redo",
+  "edit-find", "edit-clear", "edit-delete",
+  "go-next", "go-previous", "go-up", "go-down", "go-home",
+  "list-add", "list-remove", "window-close", "view-refresh",
+  "media-playback-start", "media-playback-pause", "media-playback-stop",
+  "dialog-information", "dialog-warning", "dialog-error", "dialog-question",
+  "audio-volume-high", "audio-volume-muted", "network-idle", "battery-low",
+  "folder", "user-trash-full", "drive-harddisk", "system-search",
+  "application-exit", "help-contents", "zoom-in", "zoom-out"
+};
+
+static const gint icon_sizes[] = {
+  16, 24, 48
+};
+
+static gint iterations = 20;
+
+static GOptionEntry entries[] = {
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of cold and warm runs to average", "N" },
+  { NULL }
+};
+
+static gint
+lookup_all (GtkIconTheme *icon_theme)
+{
+  GtkIconInfo *info;
+  gint i, j, found = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (icon_names); i++)
+    for (j = 0; j < G_N_ELEMENTS (icon_sizes); j++)
+      {
+        info = gtk_icon_theme_lookup_icon (icon_theme, icon_names[i],
+                                           icon_sizes[j], 0);
+        if (info != NULL)
+          {
+            found++;
+            gtk_icon_info_free (info);
+          }
+      }
+
+  return found;
+}
+
+static GtkIconTheme *
+create_icon_theme (const gchar *base_dir,
+                   const gchar *theme_name)
+{
+  GtkIconTheme *icon_theme;
+  gchar **default_path, **path;
+  gint n_elements, i;
+
+  /* look in @base_dir first, then wherever the inherited themes are */
+  gtk_icon_theme_get_search_path (gtk_icon_theme_get_default (),
+                                  &default_path, &n_elements);
+  path = g_new0 (gchar *, n_elements + 2);
+  path[0] = g_strdup (base_dir);
+
+  for (i = 0; i < n_elements; i++)
+    path[i + 1] = default_path[i];
+
+  icon_theme = gtk_icon_theme_new ();
+  gtk_icon_theme_set_search_path (icon_theme, (const gchar **) path, n_elements + 1);
+  gtk_icon_theme_set_custom_theme (icon_theme, theme_name);
+
+  g_strfreev (path);
+  g_free (default_path);
+
+  return icon_theme;
+}
+
+static void
+measure (const gchar *base_dir,
+         const gchar *theme_name,
+         const gchar *label)
+{
+  GtkIconTheme *icon_theme;
+  GTimer *timer;
+  gdouble cold = 0, warm = 0;
+  gint i, found = 0;
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < iterations; i++)
+    {
+      icon_theme = create_icon_theme (base_dir, theme_name);
+
+      g_timer_start (timer);
+      found = lookup_all (icon_theme);
+      cold += g_timer_elapsed (timer, NULL);
+
+      g_timer_start (timer);
+      lookup_all (icon_theme);
+      warm += g_timer_elapsed (timer, NULL);
+
+      g_object_unref (icon_theme);
+    }
+
+  g_print ("%-24s %-9s %6d %12.3f %12.3f\n",
+           theme_name, label, found,
+           1000.0 * cold / iterations,
+           1000.0 * warm / iterations);
+
+  g_timer_destroy (timer);
+}
+
+/* Creates @mirror_dir with symlinks to everything in @theme_dir except
+ * the icon cache, so that GTK+ has to scan the directories.
+ */
+static gboolean
+create_uncached_mirror (const gchar *theme_dir,
+                        const gchar *mirror_dir)
+{
+  GDir *dir;
+  const gchar *name;
+  gchar *target, *link;
+
+  dir = g_dir_open (theme_dir, 0, NULL);
+  if (dir == NULL || g_mkdir_with_parents (mirror_dir, 0755) != 0)
+    return FALSE;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (strcmp (name, "icon-theme.cache") == 0)
+        continue;
+
+      target = g_build_filename (theme_dir, name, NULL);
+      link = g_build_filename (mirror_dir, name, NULL);
+
+      if (symlink (target, link) != 0)
+        g_warning ("Unable to link %s", target);
+
+      g_free (target);
+      g_free (link);
+    }
+
+  g_dir_close (dir);
+
+  return TRUE;
+}
+
+static void
+remove_mirror (const gchar *mirror_dir)
+{
+  GDir *dir;
+  const gchar *name;
+  gchar *path;
+
+  dir = g_dir_open (mirror_dir, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      path = g_build_filename (mirror_dir, name, NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+  g_rmdir (mirror_dir);
+}
+
+static void
+process_theme (const gchar *theme_dir)
+{
+  gchar *base_dir, *theme_name, *tmp_dir, *mirror_name, *mirror_dir, *cache;
+
+  base_dir = g_path_get_dirname (theme_dir);
+  theme_name = g_path_get_basename (theme_dir);
+  cache = g_build_filename (theme_dir, "icon-theme.cache", NULL);
+
+  if (g_file_test (cache, G_FILE_TEST_EXISTS))
+    measure (base_dir, theme_name, "cache");
+  else
+    g_printerr ("No icon cache in %s\n", theme_dir);
+
+  tmp_dir = g_dir_make_tmp ("icon-benchmark-XXXXXX", NULL);
+  mirror_name = g_strconcat (theme_name, "-nocache", NULL);
+  mirror_dir = g_build_filename (tmp_dir, mirror_name, NULL);
+
+  if (create_uncached_mirror (theme_dir, mirror_dir))
+    measure (tmp_dir, mirror_name, "no-cache");
+
+  remove_mirror (mirror_dir);
+  g_rmdir (tmp_dir);
+
+  g_free (base_dir);
+  g_free (theme_name);
+  g_free (cache);
+  g_free (tmp_dir);
+  g_free (mirror_name);
+  g_free (mirror_dir);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gint i;
+
+  context = g_option_context_new ("THEME-DIR... - time icon lookups with and without the icon cache");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+  iterations = MAX (iterations, 1);
+
+  if (argc < 2)
+    {
+      g_printerr ("At least one installed icon theme directory must be given\n");
+      return 1;
+    }
+
+  g_print ("%d lookups per run, mean of %d runs, times in ms\n",
+           (gint) (G_N_ELEMENTS (icon_names) * G_N_ELEMENTS (icon_sizes)),
+           iterations);
+  g_print ("%-24s %-9s %6s %12s %12s\n", "theme", "", "found", "cold", "warm");
+
+  for (i = 1; i < argc; i++)
+    process_theme (argv[i]);
+
+  return 0;
+}
@@ -0,0 +1,255 @@
+/* Time to first frame benchmark
+ *
+ * Starts a small application showing arrows, expanders, focus rings,
+ * notebook tabs and a spinner with the Adwaita theme, and measures the
+ * time from the start of main() to the end of the first frame of its
+ * window, with the engine's spinner warm-up (ADWAITA_WARM_UP_SPINNERS)
+ * enabled and disabled. Every run is a new process, so that each one
+ * starts cold.
+ *
+ * This still needs a display; run it under Xvfb or the broadway backend
+ * on machines without one.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+static gint runs = 10;
+static gboolean child = FALSE;
+static gint64 start_time;
+
+static GOptionEntry entries[] = {
+  { "runs", 'n', 0, G_OPTION_ARG_INT, &runs,
+    "Number of runs with and without the spinner warm-up", "N" },
+  { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &child,
+    NULL, NULL },
+  { NULL }
+};
+
+static void
+load_theme (void)
+{
+  GtkCssProvider *provider;
+  GResource *resource;
+  GError *error = NULL;
+
+  g_object_set (gtk_settings_get_default (),
+                "gtk-theme-name", "Raleigh",
+                NULL);
+
+  resource = g_resource_load (THEMES_BUILDDIR "/Adwaita/gtk-3.0/gtk.gresource", &error);
+  if (resource == NULL)
+    g_error ("Unable to load the Adwaita resources: %s", error->message);
+
+  g_resources_register (resource);
+
+  /* this creates the engine, and starts the spinner warm-up if enabled */
+  provider = gtk_css_provider_new ();
+  if (!gtk_css_provider_load_from_path (provider, THEMES_SRCDIR "/Adwaita/gtk-3.0/gtk.css", &error))
+    g_error ("Unable to load the Adwaita theme: %s", error->message);
+
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+  g_object_unref (provider);
+}
+
+static GtkWidget *
+create_window (void)
+{
+  GtkWidget *window, *box, *notebook, *expander, *tree_view, *spinner, *entry, *widget;
+  GtkTreeStore *store;
+  GtkTreeIter parent, iter;
+  gint i;
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_add (GTK_CONTAINER (window), box);
+
+  widget = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_box_pack_start (GTK_BOX (box), widget, FALSE, FALSE, 0);
+
+  for (i = 0; i < 4; i++)
+    gtk_box_pack_start (GTK_BOX (widget),
+                        gtk_arrow_new (GTK_ARROW_UP + i, GTK_SHADOW_NONE),
+                        FALSE, FALSE, 0);
+
+  spinner = gtk_spinner_new ();
+  gtk_spinner_start (GTK_SPINNER (spinner));
+  gtk_box_pack_start (GTK_BOX (widget), spinner, FALSE, FALSE, 0);
+
+  entry = gtk_entry_new ();
+  gtk_box_pack_start (GTK_BOX (box), entry, FALSE, FALSE, 0);
+
+  expander = gtk_expander_new ("Details");
+  gtk_container_add (GTK_CONTAINER (expander), gtk_label_new ("Expanded"));
+  gtk_box_pack_start (GTK_BOX (box), expander, FALSE, FALSE, 0);
+
+  store = gtk_tree_store_new (1, G_TYPE_STRING);
+  for (i = 0; i < 5; i++)
+    {
+      gtk_tree_store_insert_with_values (store, &parent, NULL, -1, 0, "Folder", -1);
+      gtk_tree_store_insert_with_values (store, &iter, &parent, -1, 0, "Item", -1);
+    }
+
+  tree_view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (tree_view), -1, "Name",
+                                               gtk_cell_renderer_text_new (),
+                                               "text", 0, NULL);
+  gtk_box_pack_start (GTK_BOX (box), tree_view, TRUE, TRUE, 0);
+  g_object_unref (store);
+
+  notebook = gtk_notebook_new ();
+  for (i = 0; i < 4; i++)
+    gtk_notebook_append_page (GTK_NOTEBOOK (notebook),
+                              gtk_label_new ("Page"),
+                              gtk_label_new ("Tab"));
+  gtk_box_pack_start (GTK_BOX (box), notebook, TRUE, TRUE, 0);
+
+  gtk_widget_grab_focus (entry);
+
+  return window;
+}
+
+static gboolean
+first_frame_cb (GtkWidget *window,
+                cairo_t   *cr,
+                gpointer   user_data)
+{
+  gint64 *main_loop_time = user_data;
+
+  g_print ("%.2f %.2f\n",
+           (g_get_monotonic_time () - start_time) / 1000.0,
+           (g_get_monotonic_time () - *main_loop_time) / 1000.0);
+
+  g_signal_handlers_disconnect_by_func (window, first_frame_cb, user_data);
+  gtk_main_quit ();
+
+  return FALSE;
+}
+
+static void
+run_child (void)
+{
+  GtkWidget *window;
+  gint64 main_loop_time;
+
+  load_theme ();
+  window = create_window ();
+
+  g_signal_connect_after (window, "draw",
+                          G_CALLBACK (first_frame_cb), &main_loop_time);
+  gtk_widget_show_all (window);
+
+  main_loop_time = g_get_monotonic_time ();
+  gtk_main ();
+}
+
+static gint
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return (da > db) - (da < db);
+}
+
+static void
+measure (const gchar *program,
+         gboolean     warm_up)
+{
+  gchar *args[3], **envp, *output = NULL;
+  gdouble *total, *loop, total_sum = 0, loop_sum = 0;
+  GError *error = NULL;
+  gint i, n = 0;
+
+  args[0] = (gchar *) program;
+  args[1] = "--child";
+  args[2] = NULL;
+
+  envp = g_get_environ ();
+  if (warm_up)
+    envp = g_environ_setenv (envp, "ADWAITA_WARM_UP_SPINNERS", "1", TRUE);
+  else
+    envp = g_environ_unsetenv (envp, "ADWAITA_WARM_UP_SPINNERS");
+
+  total = g_new (gdouble, runs);
+  loop = g_new (gdouble, runs);
+
+  for (i = 0; i < runs; i++)
+    {
+      if (!g_spawn_sync (NULL, args, envp, G_SPAWN_SEARCH_PATH,
+                         NULL, NULL, &output, NULL, NULL, &error))
+        {
+          g_printerr ("Unable to run the benchmark: %s\n", error->message);
+          g_clear_error (&error);
+          break;
+        }
+
+      if (sscanf (output, "%lf %lf", &total[n], &loop[n]) == 2)
+        {
+          total_sum += total[n];
+          loop_sum += loop[n];
+          n++;
+        }
+
+      g_free (output);
+    }
+
+  if (n > 0)
+    {
+      qsort (total, n, sizeof (gdouble), compare_doubles);
+      qsort (loop, n, sizeof (gdouble), compare_doubles);
+
+      g_print ("%-8s %6d %12.2f %12.2f %12.2f %12.2f\n",
+               warm_up ? "on" : "off", n,
+               total_sum / n, total[n / 2],
+               loop_sum / n, loop[n / 2]);
+    }
+
+  g_free (total);
+  g_free (loop);
+  g_strfreev (envp);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  start_time = g_get_monotonic_time ();
+
+  context = g_option_context_new ("- time the first frame with and without the engine's spinner warm-up");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+  runs = MAX (runs, 1);
+
+  if (child)
+    {
+      run_child ();
+      return 0;
+    }
+
+  g_print ("time to the end of the first frame in ms, from the start of main()\n"
+           "(total) and from entering the main loop (loop)\n");
+  g_print ("%-8s %6s %12s %12s %12s %12s\n",
+           "warm-up", "runs", "total-mean", "total-median", "loop-mean", "loop-median");
+
+  measure (argv[0], FALSE);
+  measure (argv[0], TRUE);
+
+  return 0;
+}
@@ -0,0 +1,687 @@
+/* Theme rendering benchmark
+ *
+ * Builds a fixed widget gallery in a GtkOffscreenWindow for each of the
+ * shipped themes, forces state changes and renders a number of frames,
+ * reporting frame time percentiles, style recalculation time and peak
+ * RSS per theme. Every theme is measured in its own process so that the
+ * numbers don't include caches or memory from the previous one.
+ *
+ * The themes are loaded the way GTK+ loads them for applications, by
+ * name at the theme priority, from a data directory made of symlinks to
+ * the source tree. Adwaita, its dark variant and LowContrast, which
+ * imports Adwaita, select the adwaita engine; HighContrast and
+ * HighContrastInverse don't, so they're only measured as they ship,
+ * without it. For the themes that use the engine, it's disabled by a
+ * rule setting engine: none on every widget, and the same rule naming
+ * the adwaita engine is present when the engine is measured, so that
+ * both runs do the same style lookups.
+ *
+ * The style column is the time taken to resolve the style of every
+ * widget after the state changes of a frame, on its own; the frame
+ * times include it, along with layout and drawing.
+ *
+ * This still needs a display; run it under Xvfb or the broadway backend
+ * on machines without one.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <sys/resource.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+  const gchar *name;
+  const gchar *theme_name;
+  gboolean dark;
+  gboolean uses_engine;
+  const gchar *resources[2];
+} ThemeInfo;
+
+static const ThemeInfo themes[] = {
+  { "Adwaita", "Adwaita", FALSE, TRUE,
+    { "Adwaita/gtk-3.0/gtk.gresource", NULL } },
+  { "Adwaita-dark", "Adwaita", TRUE, TRUE,
+    { "Adwaita/gtk-3.0/gtk.gresource", NULL } },
+  { "HighContrast", "HighContrast", FALSE, FALSE,
+    { "HighContrast/gtk-3.0/gtk.gresource", NULL } },
+  { "HighContrastInverse", "HighContrastInverse", FALSE, FALSE,
+    { "HighContrastInverse/gtk-3.0/gtk.gresource", NULL } },
+  { "LowContrast", "LowContrast", FALSE, TRUE,
+    { "Adwaita/gtk-3.0/gtk.gresource", NULL } }
+};
+
+/* themes the ones above import from */
+static const gchar *theme_dirs[] = {
+  "Adwaita", "HighContrast", "HighContrastInverse", "LowContrast"
+};
+
+static gint n_frames = 200;
+static gint n_toolbars = 1;
+static gchar **theme_names = NULL;
+static gchar *extra_css = NULL;
+static gboolean no_engine = FALSE;
+static gboolean compare_engine = FALSE;
+static gboolean child = FALSE;
+
+static GOptionEntry entries[] = {
+  { "frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+    "Number of frames to render per theme", "N" },
+  { "toolbars", 0, 0, G_OPTION_ARG_INT, &n_toolbars,
+    "Number of toolbars in the gallery", "N" },
+  { "theme", 't', 0, G_OPTION_ARG_STRING_ARRAY, &theme_names,
+    "Only measure the given theme (can be repeated)", "NAME" },
+  { "css", 'c', 0, G_OPTION_ARG_FILENAME, &extra_css,
+    "Load an additional stylesheet on top of the theme", "FILE" },
+  { "no-engine", 0, 0, G_OPTION_ARG_NONE, &no_engine,
+    "Render with the theming engine disabled", NULL },
+  { "compare-engine", 0, 0, G_OPTION_ARG_NONE, &compare_engine,
+    "Measure every theme with and without the theming engine", NULL },
+  { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &child,
+    NULL, NULL },
+  { NULL }
+};
+
+typedef struct {
+  GtkWidget *window;
+  GtkWidget *notebook;
+  GList *stateful;
+  GList *toggles;
+  GList *all;
+} Gallery;
+
+static void
+collect_widgets (GtkWidget *widget,
+                 gpointer   user_data)
+{
+  Gallery *gallery = user_data;
+
+  gallery->all = g_list_prepend (gallery->all, widget);
+
+  if (GTK_IS_CONTAINER (widget))
+    gtk_container_forall (GTK_CONTAINER (widget), collect_widgets, gallery);
+}
+
+static GtkWidget *
+create_tree_view (void)
+{
+  GtkTreeStore *store;
+  GtkTreeIter parent, iter;
+  GtkTreePath *path;
+  GtkWidget *view, *scrolled;
+  gint i, j;
+
+  store = gtk_tree_store_new (1, G_TYPE_STRING);
+
+  for (i = 0; i < 8; i++)
+    {
+      gtk_tree_store_append (store, &parent, NULL);
+      gtk_tree_store_set (store, &parent, 0, "Folder", -1);
+
+      for (j = 0; j < 3; j++)
+        {
+          gtk_tree_store_append (store, &iter, &parent);
+          gtk_tree_store_set (store, &iter, 0, "Item", -1);
+        }
+    }
+
+  view = gtk_tree_view_new_with_model (GTK_TREE_MODEL (store));
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (view), -1, "Name",
+                                               gtk_cell_renderer_text_new (),
+                                               "text", 0,
+                                               NULL);
+  path = gtk_tree_path_new_first ();
+  gtk_tree_view_expand_row (GTK_TREE_VIEW (view), path, FALSE);
+  gtk_tree_path_free (path);
+  g_object_unref (store);
+
+  scrolled = gtk_scrolled_window_new (NULL, NULL);
+  gtk_widget_set_size_request (scrolled, 200, 200);
+  gtk_container_add (GTK_CONTAINER (scrolled), view);
+
+  return scrolled;
+}
+
+static GtkWidget *
+create_toolbar (void)
+{
+  static const gchar *stock_ids[] = {
+    GTK_STOCK_NEW, GTK_STOCK_OPEN, GTK_STOCK_SAVE,
+    GTK_STOCK_CUT, GTK_STOCK_COPY, GTK_STOCK_PASTE
+  };
+  GtkWidget *toolbar;
+  gint i;
+
+  /* inline toolbars are the ones whose gradient the engine can cache */
+  toolbar = gtk_toolbar_new ();
+  gtk_style_context_add_class (gtk_widget_get_style_context (toolbar),
+                               GTK_STYLE_CLASS_INLINE_TOOLBAR);
+
+  for (i = 0; i < G_N_ELEMENTS (stock_ids); i++)
+    gtk_toolbar_insert (GTK_TOOLBAR (toolbar),
+                        gtk_tool_button_new_from_stock (stock_ids[i]), -1);
+
+  return toolbar;
+}
+
+static GtkWidget *
+create_menubar (void)
+{
+  static const gchar *labels[] = { "File", "Edit", "View", "Help" };
+  GtkWidget *menubar, *item, *menu;
+  gint i;
+
+  menubar = gtk_menu_bar_new ();
+
+  for (i = 0; i < G_N_ELEMENTS (labels); i++)
+    {
+      item = gtk_menu_item_new_with_label (labels[i]);
+      menu = gtk_menu_new ();
+      gtk_menu_shell_append (GTK_MENU_SHELL (menu),
+                             gtk_menu_item_new_with_label ("Item"));
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), menu);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menubar), item);
+    }
+
+  return menubar;
+}
+
+static void
+create_gallery (Gallery *gallery)
+{
+  GtkWidget *vbox, *hbox, *widget, *radio, *expander, *frame;
+  gint i;
+
+  memset (gallery, 0, sizeof (Gallery));
+
+  gallery->window = gtk_offscreen_window_new ();
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+  gtk_container_add (GTK_CONTAINER (gallery->window), vbox);
+
+  gtk_box_pack_start (GTK_BOX (vbox), create_menubar (), FALSE, FALSE, 0);
+
+  for (i = 0; i < n_toolbars; i++)
+    gtk_box_pack_start (GTK_BOX (vbox), create_toolbar (), FALSE, FALSE, 0);
+
+  /* buttons */
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
+
+  for (i = 0; i < 4; i++)
+    {
+      widget = gtk_button_new_with_label ("Button");
+      gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+      gallery->stateful = g_list_prepend (gallery->stateful, widget);
+    }
+
+  widget = gtk_toggle_button_new_with_label ("Toggle");
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+  gallery->toggles = g_list_prepend (gallery->toggles, widget);
+
+  widget = gtk_check_button_new_with_label ("Check");
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+  gallery->toggles = g_list_prepend (gallery->toggles, widget);
+  gallery->stateful = g_list_prepend (gallery->stateful, widget);
+
+  radio = gtk_radio_button_new_with_label (NULL, "Radio");
+  gtk_box_pack_start (GTK_BOX (hbox), radio, FALSE, FALSE, 0);
+  widget = gtk_radio_button_new_with_label_from_widget (GTK_RADIO_BUTTON (radio), "Radio");
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+  gallery->toggles = g_list_prepend (gallery->toggles, widget);
+
+  widget = gtk_switch_new ();
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+  /* entries and ranges */
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
+
+  widget = gtk_entry_new ();
+  gtk_entry_set_text (GTK_ENTRY (widget), "Entry");
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+  gallery->stateful = g_list_prepend (gallery->stateful, widget);
+
+  widget = gtk_spin_button_new_with_range (0, 100, 1);
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+  widget = gtk_combo_box_text_new ();
+  gtk_combo_box_text_append_text (GTK_COMBO_BOX_TEXT (widget), "Combo");
+  gtk_combo_box_set_active (GTK_COMBO_BOX (widget), 0);
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+  widget = gtk_scale_new_with_range (GTK_ORIENTATION_HORIZONTAL, 0, 100, 1);
+  gtk_widget_set_size_request (widget, 120, -1);
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+  widget = gtk_progress_bar_new ();
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (widget), 0.6);
+  gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+  for (i = 0; i < 3; i++)
+    {
+      widget = gtk_spinner_new ();
+      gtk_spinner_start (GTK_SPINNER (widget));
+      gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+    }
+
+  /* notebook, tree view and expanders */
+  hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+  gtk_box_pack_start (GTK_BOX (vbox), hbox, TRUE, TRUE, 0);
+
+  gallery->notebook = gtk_notebook_new ();
+  for (i = 0; i < 4; i++)
+    gtk_notebook_append_page (GTK_NOTEBOOK (gallery->notebook),
+                              gtk_label_new ("Page"),
+                              gtk_label_new ("Tab"));
+  gtk_widget_set_size_request (gallery->notebook, 240, 120);
+  gtk_box_pack_start (GTK_BOX (hbox), gallery->notebook, TRUE, TRUE, 0);
+
+  gtk_box_pack_start (GTK_BOX (hbox), create_tree_view (), TRUE, TRUE, 0);
+
+  frame = gtk_frame_new ("Frame");
+  gtk_box_pack_start (GTK_BOX (vbox), frame, FALSE, FALSE, 0);
+  expander = gtk_expander_new ("Expander");
+  gtk_container_add (GTK_CONTAINER (expander), gtk_label_new ("Contents"));
+  gtk_container_add (GTK_CONTAINER (frame), expander);
+  gallery->toggles = g_list_prepend (gallery->toggles, expander);
+
+  gtk_widget_show_all (gallery->window);
+  collect_widgets (gallery->window, gallery);
+
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+}
+
+static void
+free_gallery (Gallery *gallery)
+{
+  gtk_widget_destroy (gallery->window);
+  g_list_free (gallery->stateful);
+  g_list_free (gallery->toggles);
+  g_list_free (gallery->all);
+}
+
+static void
+load_theme (const ThemeInfo *info)
+{
+  GtkCssProvider *provider;
+  GResource *resource;
+  GError *error = NULL;
+  gchar *path;
+  gint i;
+
+  /* the stylesheets import these, and the build tree ones may not be
+   * the installed ones
+   */
+  for (i = 0; i < G_N_ELEMENTS (info->resources) && info->resources[i]; i++)
+    {
+      path = g_build_filename (THEMES_BUILDDIR, info->resources[i], NULL);
+      resource = g_resource_load (path, &error);
+
+      if (resource == NULL)
+        g_error ("Unable to load %s: %s", path, error->message);
+
+      g_resources_register (resource);
+      g_free (path);
+    }
+
+  /* GTK_DATA_PREFIX points at the mirror of the source tree */
+  g_object_set (gtk_settings_get_default (),
+                "gtk-application-prefer-dark-theme", info->dark,
+                "gtk-theme-name", info->theme_name,
+                NULL);
+
+  if (extra_css != NULL)
+    {
+      provider = gtk_css_provider_new ();
+
+      if (!gtk_css_provider_load_from_path (provider, extra_css, &error))
+        g_error ("Unable to load %s: %s", extra_css, error->message);
+
+      gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                                 GTK_STYLE_PROVIDER (provider),
+                                                 GTK_STYLE_PROVIDER_PRIORITY_APPLICATION + 1);
+      g_object_unref (provider);
+    }
+
+  /* the themes without the engine are left as they ship */
+  if (!info->uses_engine)
+    return;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider,
+                                   no_engine ? "* { engine: none; }" : "* { engine: adwaita; }",
+                                   -1, NULL);
+  gtk_style_context_add_provider_for_screen (gdk_screen_get_default (),
+                                             GTK_STYLE_PROVIDER (provider),
+                                             GTK_STYLE_PROVIDER_PRIORITY_APPLICATION + 2);
+  g_object_unref (provider);
+}
+
+static void
+apply_states (Gallery *gallery,
+              gint     frame)
+{
+  static const GtkStateFlags states[] = {
+    GTK_STATE_FLAG_NORMAL,
+    GTK_STATE_FLAG_PRELIGHT,
+    GTK_STATE_FLAG_ACTIVE,
+    GTK_STATE_FLAG_PRELIGHT | GTK_STATE_FLAG_ACTIVE
+  };
+  GList *l;
+  gint idx;
+
+  for (l = gallery->stateful, idx = frame; l != NULL; l = l->next, idx++)
+    gtk_widget_set_state_flags (l->data, states[idx % G_N_ELEMENTS (states)], TRUE);
+
+  if (frame % 4 == 0)
+    for (l = gallery->toggles; l != NULL; l = l->next)
+      {
+        if (GTK_IS_EXPANDER (l->data))
+          gtk_expander_set_expanded (l->data, !gtk_expander_get_expanded (l->data));
+        else
+          gtk_toggle_button_set_active (l->data, !gtk_toggle_button_get_active (l->data));
+      }
+
+  if (frame % 10 == 0)
+    gtk_notebook_set_current_page (GTK_NOTEBOOK (gallery->notebook),
+                                   (frame / 10) % 4);
+}
+
+/* Resolve the style of every widget, which is otherwise done lazily
+ * while drawing.
+ */
+static void
+resolve_styles (Gallery *gallery)
+{
+  GtkStyleContext *context;
+  GdkRGBA color;
+  GList *l;
+
+  for (l = gallery->all; l != NULL; l = l->next)
+    {
+      context = gtk_widget_get_style_context (l->data);
+      gtk_style_context_get_color (context,
+                                   gtk_style_context_get_state (context),
+                                   &color);
+      gtk_style_context_get_background_color (context,
+                                              gtk_style_context_get_state (context),
+                                              &color);
+    }
+}
+
+static gint
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+  gdouble da = *(const gdouble *) a;
+  gdouble db = *(const gdouble *) b;
+
+  return (da > db) - (da < db);
+}
+
+static gdouble
+percentile (gdouble *sorted,
+            gint     n,
+            gdouble  p)
+{
+  return sorted[CLAMP ((gint) (p * (n - 1) + 0.5), 0, n - 1)];
+}
+
+static void
+run_theme (const ThemeInfo *info)
+{
+  Gallery gallery;
+  GtkAllocation allocation;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  GTimer *timer, *style_timer;
+  gdouble *frame_times, style_time;
+  struct rusage usage;
+  gint frame;
+
+  load_theme (info);
+  create_gallery (&gallery);
+
+  gtk_widget_get_allocation (gallery.window, &allocation);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        allocation.width, allocation.height);
+  frame_times = g_new (gdouble, n_frames);
+  style_time = 0;
+  timer = g_timer_new ();
+  style_timer = g_timer_new ();
+
+  for (frame = 0; frame < n_frames; frame++)
+    {
+      g_timer_start (timer);
+
+      apply_states (&gallery, frame);
+
+      /* before the main loop gets a chance to do it while laying out */
+      g_timer_start (style_timer);
+      resolve_styles (&gallery);
+      style_time += g_timer_elapsed (style_timer, NULL);
+
+      while (gtk_events_pending ())
+        gtk_main_iteration ();
+
+      cr = cairo_create (surface);
+      gtk_widget_draw (gallery.window, cr);
+      cairo_destroy (cr);
+      cairo_surface_flush (surface);
+
+      frame_times[frame] = 1000.0 * g_timer_elapsed (timer, NULL);
+    }
+
+  qsort (frame_times, n_frames, sizeof (gdouble), compare_doubles);
+  getrusage (RUSAGE_SELF, &usage);
+
+  g_print ("%-20s %-7s %8.2f %8.2f %8.2f %8.2f %10.2f %10ld\n",
+           info->name,
+           no_engine || !info->uses_engine ? "no" : "yes",
+           percentile (frame_times, n_frames, 0.50),
+           percentile (frame_times, n_frames, 0.90),
+           percentile (frame_times, n_frames, 0.99),
+           frame_times[n_frames - 1],
+           1000.0 * style_time / n_frames,
+           usage.ru_maxrss);
+
+  g_timer_destroy (timer);
+  g_timer_destroy (style_timer);
+  g_free (frame_times);
+  cairo_surface_destroy (surface);
+  free_gallery (&gallery);
+}
+
+static gboolean
+theme_is_selected (const ThemeInfo *info)
+{
+  gint i;
+
+  if (theme_names == NULL)
+    return TRUE;
+
+  for (i = 0; theme_names[i] != NULL; i++)
+    if (g_strcmp0 (theme_names[i], info->name) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Creates DATA-DIR/share/themes with a symlink to each theme of the
+ * source tree, and returns the environment pointing GTK+ at it.
+ */
+static gchar **
+create_data_dir (const gchar *data_dir)
+{
+  gchar *themes_dir, *target, *link, *share_dir, **envp;
+  guint i;
+
+  share_dir = g_build_filename (data_dir, "share", NULL);
+  themes_dir = g_build_filename (share_dir, "themes", NULL);
+  g_mkdir_with_parents (themes_dir, 0755);
+
+  for (i = 0; i < G_N_ELEMENTS (theme_dirs); i++)
+    {
+      target = g_build_filename (THEMES_SRCDIR, theme_dirs[i], NULL);
+      link = g_build_filename (themes_dir, theme_dirs[i], NULL);
+
+      if (symlink (target, link) != 0)
+        g_warning ("Unable to link %s", target);
+
+      g_free (target);
+      g_free (link);
+    }
+
+  /* the user's own themes would come first otherwise */
+  envp = g_get_environ ();
+  envp = g_environ_setenv (envp, "GTK_DATA_PREFIX", data_dir, TRUE);
+  envp = g_environ_setenv (envp, "XDG_DATA_HOME", share_dir, TRUE);
+  envp = g_environ_setenv (envp, "HOME", data_dir, TRUE);
+  envp = g_environ_unsetenv (envp, "GTK_THEME");
+
+  g_free (themes_dir);
+  g_free (share_dir);
+
+  return envp;
+}
+
+static void
+remove_data_dir (const gchar *data_dir)
+{
+  gchar *path;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (theme_dirs); i++)
+    {
+      path = g_build_filename (data_dir, "share", "themes", theme_dirs[i], NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+
+  path = g_build_filename (data_dir, "share", "themes", NULL);
+  g_rmdir (path);
+  g_free (path);
+
+  path = g_build_filename (data_dir, "share", NULL);
+  g_rmdir (path);
+  g_free (path);
+
+  g_rmdir (data_dir);
+}
+
+static void
+spawn_theme (const gchar     *program,
+             gchar          **envp,
+             const ThemeInfo *info,
+             gboolean         disable_engine)
+{
+  GPtrArray *args;
+  GError *error = NULL;
+  gchar *frames, *toolbars;
+
+  frames = g_strdup_printf ("--frames=%d", n_frames);
+  toolbars = g_strdup_printf ("--toolbars=%d", n_toolbars);
+
+  args = g_ptr_array_new ();
+  g_ptr_array_add (args, (gpointer) program);
+  g_ptr_array_add (args, "--child");
+  g_ptr_array_add (args, frames);
+  g_ptr_array_add (args, toolbars);
+  g_ptr_array_add (args, "--theme");
+  g_ptr_array_add (args, (gpointer) info->name);
+
+  if (extra_css != NULL)
+    {
+      g_ptr_array_add (args, "--css");
+      g_ptr_array_add (args, extra_css);
+    }
+
+  if (disable_engine)
+    g_ptr_array_add (args, "--no-engine");
+
+  g_ptr_array_add (args, NULL);
+
+  /* the child shares our stdout */
+  fflush (stdout);
+
+  if (!g_spawn_sync (NULL, (gchar **) args->pdata, envp, G_SPAWN_SEARCH_PATH,
+                     NULL, NULL, NULL, NULL, NULL, &error))
+    {
+      g_printerr ("Unable to run the benchmark for %s: %s\n",
+                  info->name, error->message);
+      g_clear_error (&error);
+    }
+
+  g_ptr_array_free (args, TRUE);
+  g_free (frames);
+  g_free (toolbars);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *data_dir, **envp;
+  gint i;
+
+  context = g_option_context_new ("- measure the rendering cost of the shipped themes");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+  n_frames = MAX (n_frames, 1);
+  n_toolbars = MAX (n_toolbars, 0);
+
+  if (child)
+    {
+      for (i = 0; i < G_N_ELEMENTS (themes); i++)
+        if (theme_is_selected (&themes[i]))
+          {
+            run_theme (&themes[i]);
+            break;
+          }
+
+      return 0;
+    }
+
+  data_dir = g_dir_make_tmp ("theme-benchmark-XXXXXX", NULL);
+  if (data_dir == NULL)
+    {
+      g_printerr ("Unable to create a temporary directory\n");
+      return 1;
+    }
+
+  envp = create_data_dir (data_dir);
+
+  g_print ("%d frames per theme, times in ms, peak RSS in kB\n", n_frames);
+  g_print ("%-20s %-7s %8s %8s %8s %8s %10s %10s\n",
+           "theme", "engine", "p50", "p90", "p99", "max", "style", "peak-rss");
+
+  for (i = 0; i < G_N_ELEMENTS (themes); i++)
+    {
+      if (!theme_is_selected (&themes[i]))
+        continue;
+
+      spawn_theme (argv[0], envp, &themes[i], no_engine);
+
+      if (compare_engine && !no_engine && themes[i].uses_engine)
+        spawn_theme (argv[0], envp, &themes[i], TRUE);
+    }
+
+  remove_data_dir (data_dir);
+  g_strfreev (envp);
+  g_free (data_dir);
+
+  return 0;
+}
@@ -0,0 +1,404 @@
+/* Toolbar and menu population benchmark
+ *
+ * Fills a toolbar and a menu with every icon of the LowContrast theme
+ * and reports how long that takes and how much heap it leaves behind,
+ * once with the theme reduced to its 48x48 icons, which GTK+ has to
+ * scale down for every toolbar and menu item, and once with the sizes
+ * made by create-lowcontrast. The first population of each run is
+ * cold, the next ones reuse whatever GTK+ cached.
+ *
+ * The two themes are mirrors of the one in the source tree, made of
+ * symlinks to its size directories and an index.theme listing only
+ * those. Every setup is measured in its own process.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THEME_DIR THEMES_SRCDIR "/LowContrast/icons"
+/* the smaller sizes are scaled from 48x48 when the theme is built */
+#define RENDER_DIR THEMES_BUILDDIR "/LowContrast/icons"
+
+typedef struct {
+  const gchar *name;
+  gboolean all_sizes;
+} Setup;
+
+static const Setup setups[] = {
+  { "48x48", FALSE },
+  { "all", TRUE }
+};
+
+static gint iterations = 20;
+static gchar *child = NULL;
+
+static GOptionEntry entries[] = {
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+    "Number of warm populations to average", "N" },
+  { "child", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_FILENAME, &child,
+    NULL, NULL },
+  { NULL }
+};
+
+static gsize
+get_heap_size (void)
+{
+  return mallinfo ().uordblks;
+}
+
+/* The names of the 48x48 icons of the theme in @theme_dir */
+static GPtrArray *
+list_icons (const gchar *theme_dir)
+{
+  GPtrArray *names;
+  GDir *sizes_dir, *dir;
+  const gchar *context, *name;
+  gchar *path, *context_path;
+
+  names = g_ptr_array_new_with_free_func (g_free);
+  path = g_build_filename (theme_dir, "48x48", NULL);
+  sizes_dir = g_dir_open (path, 0, NULL);
+
+  while (sizes_dir != NULL && (context = g_dir_read_name (sizes_dir)) != NULL)
+    {
+      context_path = g_build_filename (path, context, NULL);
+      dir = g_dir_open (context_path, 0, NULL);
+
+      while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+        if (g_str_has_suffix (name, ".png"))
+          g_ptr_array_add (names, g_strndup (name, strlen (name) - strlen (".png")));
+
+      if (dir != NULL)
+        g_dir_close (dir);
+
+      g_free (context_path);
+    }
+
+  if (sizes_dir != NULL)
+    g_dir_close (sizes_dir);
+
+  g_free (path);
+
+  return names;
+}
+
+static GtkWidget *
+create_toolbar (GPtrArray *names)
+{
+  GtkWidget *toolbar;
+  GtkToolItem *item;
+  gint i;
+
+  toolbar = gtk_toolbar_new ();
+
+  /* items in the overflow menu wouldn't get their icons loaded */
+  gtk_toolbar_set_show_arrow (GTK_TOOLBAR (toolbar), FALSE);
+
+  for (i = 0; i < names->len; i++)
+    {
+      item = gtk_tool_button_new (NULL, g_ptr_array_index (names, i));
+      gtk_tool_button_set_icon_name (GTK_TOOL_BUTTON (item),
+                                     g_ptr_array_index (names, i));
+      gtk_widget_show (GTK_WIDGET (item));
+      gtk_toolbar_insert (GTK_TOOLBAR (toolbar), item, -1);
+    }
+
+  return toolbar;
+}
+
+static GtkWidget *
+create_menu (GPtrArray *names)
+{
+  GtkWidget *menu, *item, *box;
+  gint i;
+
+  menu = gtk_menu_new ();
+
+  for (i = 0; i < names->len; i++)
+    {
+      box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+      gtk_box_pack_start (GTK_BOX (box),
+                          gtk_image_new_from_icon_name (g_ptr_array_index (names, i),
+                                                        GTK_ICON_SIZE_MENU),
+                          FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (box),
+                          gtk_label_new (g_ptr_array_index (names, i)),
+                          FALSE, FALSE, 0);
+
+      item = gtk_menu_item_new ();
+      gtk_container_add (GTK_CONTAINER (item), box);
+      gtk_widget_show_all (item);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+    }
+
+  return menu;
+}
+
+/* Creates the widgets and requests their size, which is when the
+ * images load their icons.
+ */
+static gdouble
+populate (GtkWidget * (* create) (GPtrArray *),
+          GPtrArray *names,
+          GTimer    *timer)
+{
+  GtkWidget *widget;
+  GtkRequisition requisition;
+  gdouble elapsed;
+
+  g_timer_start (timer);
+
+  widget = g_object_ref_sink (create (names));
+  gtk_widget_get_preferred_size (widget, NULL, &requisition);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+
+  gtk_widget_destroy (widget);
+  g_object_unref (widget);
+
+  return elapsed;
+}
+
+static void
+run_setup (const gchar *theme_dir)
+{
+  GtkIconTheme *icon_theme;
+  GPtrArray *names;
+  GTimer *timer;
+  gchar **default_path, **path, *name;
+  gdouble cold_toolbar, cold_menu, warm_toolbar = 0, warm_menu = 0;
+  gsize heap;
+  gint n_elements, i;
+
+  names = list_icons (theme_dir);
+
+  /* look in the mirror first, then wherever the inherited themes are */
+  icon_theme = gtk_icon_theme_get_default ();
+  gtk_icon_theme_get_search_path (icon_theme, &default_path, &n_elements);
+  path = g_new0 (gchar *, n_elements + 2);
+  path[0] = g_path_get_dirname (theme_dir);
+
+  for (i = 0; i < n_elements; i++)
+    path[i + 1] = default_path[i];
+
+  gtk_icon_theme_set_search_path (icon_theme, (const gchar **) path, n_elements + 1);
+
+  name = g_path_get_basename (theme_dir);
+  g_object_set (gtk_settings_get_default (),
+                "gtk-icon-theme-name", name,
+                NULL);
+
+  timer = g_timer_new ();
+  heap = get_heap_size ();
+
+  cold_toolbar = populate (create_toolbar, names, timer);
+  cold_menu = populate (create_menu, names, timer);
+
+  for (i = 0; i < iterations; i++)
+    {
+      warm_toolbar += populate (create_toolbar, names, timer);
+      warm_menu += populate (create_menu, names, timer);
+    }
+
+  /* the widgets are gone, this is what GTK+ kept around */
+  heap = get_heap_size () - heap;
+
+  g_print ("%-8s %6u %10.2f %10.2f %10.2f %10.2f %10" G_GSIZE_FORMAT "\n",
+           strrchr (name, '-') + 1, names->len,
+           1000.0 * cold_toolbar, 1000.0 * cold_menu,
+           1000.0 * warm_toolbar / iterations, 1000.0 * warm_menu / iterations,
+           heap / 1024);
+
+  g_timer_destroy (timer);
+  g_ptr_array_unref (names);
+  g_strfreev (path);
+  g_free (default_path);
+  g_free (name);
+}
+
+/* Creates a copy of the theme in @mirror_dir that only has the 48x48
+ * directories, or all of them, each a symlink to the source tree.
+ */
+static gboolean
+create_mirror (const gchar *mirror_dir,
+               const Setup *setup)
+{
+  GKeyFile *key_file;
+  GError *error = NULL;
+  gchar **directories, **kept, *size, *target, *link, *index, *data;
+  gsize n_directories = 0, n_kept = 0, length, i;
+  gboolean retval = FALSE;
+
+  key_file = g_key_file_new ();
+  index = g_build_filename (THEME_DIR, "index.theme", NULL);
+
+  if (!g_key_file_load_from_file (key_file, index, G_KEY_FILE_NONE, &error))
+    {
+      g_printerr ("Unable to load %s: %s\n", index, error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  g_mkdir_with_parents (mirror_dir, 0755);
+
+  directories = g_key_file_get_string_list (key_file, "Icon Theme", "Directories",
+                                            &n_directories, NULL);
+  kept = g_new0 (gchar *, n_directories + 1);
+
+  for (i = 0; directories != NULL && i < n_directories; i++)
+    {
+      size = g_path_get_dirname (directories[i]);
+      target = g_build_filename (strcmp (size, "48x48") == 0 ? THEME_DIR : RENDER_DIR,
+                                 size, NULL);
+      link = g_build_filename (mirror_dir, size, NULL);
+
+      if ((setup->all_sizes || strcmp (size, "48x48") == 0) &&
+          g_file_test (target, G_FILE_TEST_IS_DIR))
+        {
+          kept[n_kept++] = directories[i];
+
+          if (!g_file_test (link, G_FILE_TEST_EXISTS) && symlink (target, link) != 0)
+            g_warning ("Unable to link %s", target);
+        }
+      else
+        {
+          g_key_file_remove_group (key_file, directories[i], NULL);
+        }
+
+      g_free (size);
+      g_free (target);
+      g_free (link);
+    }
+
+  g_key_file_set_string_list (key_file, "Icon Theme", "Directories",
+                              (const gchar * const *) kept, n_kept);
+
+  g_free (index);
+  index = g_build_filename (mirror_dir, "index.theme", NULL);
+  data = g_key_file_to_data (key_file, &length, NULL);
+  retval = g_file_set_contents (index, data, length, NULL);
+
+  g_free (data);
+  g_free (kept);
+  g_strfreev (directories);
+
+ out:
+  g_free (index);
+  g_key_file_free (key_file);
+
+  return retval;
+}
+
+static void
+remove_mirror (const gchar *mirror_dir)
+{
+  GDir *dir;
+  const gchar *name;
+  gchar *path;
+
+  dir = g_dir_open (mirror_dir, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      path = g_build_filename (mirror_dir, name, NULL);
+      g_unlink (path);
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+  g_rmdir (mirror_dir);
+}
+
+static void
+spawn_setup (const gchar *program,
+             const gchar *tmp_dir,
+             const Setup *setup)
+{
+  GError *error = NULL;
+  gchar *args[5], *mirror_name, *mirror_dir;
+
+  mirror_name = g_strconcat ("LowContrast-", setup->name, NULL);
+  mirror_dir = g_build_filename (tmp_dir, mirror_name, NULL);
+
+  if (!create_mirror (mirror_dir, setup))
+    goto out;
+
+  args[0] = (gchar *) program;
+  args[1] = g_strdup_printf ("--iterations=%d", iterations);
+  args[2] = "--child";
+  args[3] = mirror_dir;
+  args[4] = NULL;
+
+  /* the child shares our stdout */
+  fflush (stdout);
+
+  if (!g_spawn_sync (NULL, args, NULL, G_SPAWN_SEARCH_PATH,
+                     NULL, NULL, NULL, NULL, NULL, &error))
+    {
+      g_printerr ("Unable to run the benchmark for %s: %s\n",
+                  setup->name, error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (args[1]);
+
+ out:
+  remove_mirror (mirror_dir);
+  g_free (mirror_name);
+  g_free (mirror_dir);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *tmp_dir;
+  gint i;
+
+  context = g_option_context_new ("- time filling toolbars and menus with the LowContrast icons");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+  iterations = MAX (iterations, 1);
+
+  if (child != NULL)
+    {
+      run_setup (child);
+      return 0;
+    }
+
+  tmp_dir = g_dir_make_tmp ("toolbar-benchmark-XXXXXX", NULL);
+  if (tmp_dir == NULL)
+    {
+      g_printerr ("Unable to create a temporary directory\n");
+      return 1;
+    }
+
+  g_print ("time to fill a toolbar (24px) and a menu (16px) in ms, cold and mean\n"
+           "of %d warm runs, and heap left behind by all the runs in kB\n",
+           iterations);
+  g_print ("%-8s %6s %10s %10s %10s %10s %10s\n",
+           "sizes", "icons", "toolbar", "menu", "toolbar-w", "menu-w", "heap");
+
+  for (i = 0; i < G_N_ELEMENTS (setups); i++)
+    spawn_setup (argv[0], tmp_dir, &setups[i]);
+
+  g_rmdir (tmp_dir);
+  g_free (tmp_dir);
+
+  return 0;
+}
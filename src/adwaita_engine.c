@@ -57,9 +57,22 @@ void  adwaita_engine_register_types (GTypeModule *module);
 
 G_DEFINE_DYNAMIC_TYPE (AdwaitaEngine, adwaita_engine, GTK_TYPE_THEMING_ENGINE)
 
+#define ADWAITA_TYPE_RENDER_QUALITY (adwaita_render_quality_type)
+
+static GType adwaita_render_quality_type = G_TYPE_INVALID;
+
+static const GEnumValue adwaita_render_quality_values[] = {
+  { ADWAITA_RENDER_QUALITY_BEST, "ADWAITA_RENDER_QUALITY_BEST", "best" },
+  { ADWAITA_RENDER_QUALITY_FAST, "ADWAITA_RENDER_QUALITY_FAST", "fast" },
+  { 0, NULL, NULL }
+};
+
 void
 adwaita_engine_register_types (GTypeModule *module)
 {
+  adwaita_render_quality_type =
+    g_type_module_register_enum (module, "AdwaitaRenderQuality",
+                                 adwaita_render_quality_values);
   adwaita_engine_register_type (module);
 }
 
@@ -68,6 +81,22 @@ adwaita_engine_init (AdwaitaEngine *self)
 {
 }
 
+/* In the fast mode geometry is snapped to whole pixels, antialiasing
+ * is reduced and arcs are replaced by straight chamfers, which is a lot
+ * cheaper on software rendered and remote sessions.
+ */
+static AdwaitaRenderQuality
+get_render_quality (GtkThemingEngine *engine)
+{
+  AdwaitaRenderQuality quality = ADWAITA_RENDER_QUALITY_BEST;
+
+  gtk_theming_engine_get (engine, gtk_theming_engine_get_state (engine),
+                          "-adwaita-render-quality", &quality,
+                          NULL);
+
+  return quality;
+}
+
 static void
 adwaita_engine_render_arrow (GtkThemingEngine *engine,
                              cairo_t          *cr,
@@ -76,35 +105,17 @@ adwaita_engine_render_arrow (GtkThemingEngine *engine,
                              gdouble           y,
                              gdouble           size)
 {
-  double line_width;
   GtkStateFlags state;
   GdkRGBA color;
 
-  cairo_save (cr);
-
-  line_width = size / 3.0 / sqrt (2);
-  cairo_set_line_width (cr, line_width);
-  cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
-  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-
-  cairo_translate (cr, x + size / 2.0, y + size / 2.0);
-  cairo_rotate (cr, angle - G_PI_2);
-  cairo_translate (cr, size / 4.0, 0);
- 
-  cairo_scale (cr,
-               (size / (size + line_width)),
-               (size / (size + line_width)));
-
-  cairo_move_to (cr, -size / 2.0, -size / 2.0);
-  cairo_rel_line_to (cr, size / 2.0, size / 2.0);
-  cairo_rel_line_to (cr, - size / 2.0, size / 2.0);
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_ARROW, cr, x, y, size, size))
+    return;
 
   state = gtk_theming_engine_get_state (engine);
   gtk_theming_engine_get_color (engine, state, &color);
-  gdk_cairo_set_source_rgba (cr, &color);
-  cairo_stroke (cr);
 
-  cairo_restore (cr);
+  _adwaita_draw_arrow (cr, get_render_quality (engine), &color,
+                       angle, x, y, size);
 }
 
 static void
@@ -120,9 +131,11 @@ adwaita_engine_render_focus (GtkThemingEngine *engine,
   gint line_width, focus_pad;
   gint border_radius;
   gboolean use_dashes;
-  double dashes[2] = { 2.0, 0.2 };
   const GtkWidgetPath *path;
 
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_FOCUS, cr, x, y, width, height))
+    return;
+
   path = gtk_theming_engine_get_path (engine);
   state = gtk_theming_engine_get_state (engine);
   gtk_theming_engine_get (engine, state,
@@ -157,55 +170,24 @@ adwaita_engine_render_focus (GtkThemingEngine *engine,
       height -= 2 * focus_pad;
     }
 
-  cairo_save (cr);
-  cairo_set_line_width (cr, line_width);
-
-  if (line_width > 1)
-    _cairo_round_rectangle_sides (cr, border_radius,
-                                  x, y, width, height,
-                                  SIDE_ALL, GTK_JUNCTION_NONE);
-  else
-    _cairo_round_rectangle_sides (cr, border_radius,
-                                  x + 0.5, y + 0.5,
-                                  width - 1, height - 1,
-                                  SIDE_ALL, GTK_JUNCTION_NONE);
-
-  if (use_dashes)
-    cairo_set_dash (cr, dashes, 1, 0.0);
-
-  if (border_color != NULL)
-    gdk_cairo_set_source_rgba (cr, border_color);
-
-  cairo_stroke (cr);
-  cairo_restore (cr);
+  _adwaita_draw_focus (cr, get_render_quality (engine), border_color,
+                       border_radius, use_dashes, line_width,
+                       x, y, width, height);
 
   if (border_color != NULL)
     gdk_rgba_free (border_color);
 }
 
-#define NOTEBOOK_TAB_TOP_MARGIN 3.0
-
 static void
-draw_tab_shape (cairo_t *cr,
-                gdouble curve_width,
-                gdouble x,
-                gdouble y,
-                gdouble width,
-                gdouble height)
+render_parent_background (cairo_t *cr,
+                          gdouble  x,
+                          gdouble  y,
+                          gdouble  width,
+                          gdouble  height,
+                          gpointer user_data)
 {
-  cairo_move_to (cr, x, height);
-
-  cairo_arc (cr, 
-             x + curve_width, y + 3.0,
-             2.5,
-             G_PI, G_PI + G_PI_2);
-
-  cairo_arc (cr,
-             x + width - curve_width, y + 3.0,
-             2.5,
-             G_PI + G_PI_2, 2 * G_PI);
-
-  cairo_line_to (cr, x + width, height);
+  GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_background
+    (user_data, cr, x, y, width, height);
 }
 
 static void
@@ -217,84 +199,29 @@ render_notebook_extension (GtkThemingEngine *engine,
                            gdouble           height,
                            GtkPositionType   gap_side)
 {
-  gint tab_curvature, border_width;
-  GdkRGBA border_color, background_color;
+  gint tab_curvature;
+  GdkRGBA border_color;
   GtkStateFlags state;
-  gdouble angle = 0;
   cairo_pattern_t *pattern = NULL;
-  gboolean is_active;
 
   gtk_theming_engine_get_style (engine,
                                 "tab-curvature", &tab_curvature,
                                 NULL);
   state = gtk_theming_engine_get_state (engine);
-  gtk_theming_engine_get_background_color (engine, state, &background_color);
   gtk_theming_engine_get_border_color (engine, state, &border_color);
   gtk_theming_engine_get (engine, state,
                           "-adwaita-border-gradient", &pattern,
                           NULL);
 
-  is_active = (state & GTK_STATE_FLAG_ACTIVE);
-  border_width = 1.0;
-
-  cairo_save (cr);
-  cairo_set_line_width (cr, border_width);
-
-  if (gap_side == GTK_POS_BOTTOM)
-    x += border_width / 2;
-  else if (gap_side == GTK_POS_TOP)
-    x -= border_width / 2;
-
-  if (gap_side == GTK_POS_TOP)
-    {
-      angle = G_PI;
-      cairo_translate (cr, x + width, y + height - NOTEBOOK_TAB_TOP_MARGIN - border_width);
-    }
-  else
-    {
-      cairo_translate (cr, x, y + NOTEBOOK_TAB_TOP_MARGIN + border_width);
-    }
-
-  cairo_rotate (cr, angle);
-
-  width -= border_width;
-  height -= NOTEBOOK_TAB_TOP_MARGIN + border_width;
-
-  /* draw the tab shape and clip the background inside it */
-  cairo_save (cr);
-  draw_tab_shape (cr, tab_curvature, 
-                  0, 0.5,
-                  width, is_active ? (height + 1.0) : (height));
-  cairo_clip (cr);
-
-  GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_background
-    (engine, cr, 0, 0.5,
-     width, is_active ? (height + 1.0) : (height));
-
-  cairo_restore (cr);
-
-  /* now draw the border */
-  draw_tab_shape (cr, tab_curvature,
-                  0, 0,
-                  width, height);
-
-  if (pattern && (state & GTK_STATE_FLAG_ACTIVE))
-    {
-      cairo_scale (cr, width, height);
-      cairo_set_source (cr, pattern);
-      cairo_scale (cr, 1.0 / width, 1.0 / height);
-    }
-  else
-    {
-      gdk_cairo_set_source_rgba (cr, &border_color);
-    }
-
-  cairo_stroke (cr);
+  _adwaita_draw_notebook_tab (cr, get_render_quality (engine),
+                              tab_curvature, gap_side,
+                              (state & GTK_STATE_FLAG_ACTIVE) != 0,
+                              &border_color, pattern,
+                              render_parent_background, engine,
+                              x, y, width, height);
 
   if (pattern != NULL)
     cairo_pattern_destroy (pattern);
-
-  cairo_restore (cr);
 }
 
 static void
@@ -306,6 +233,9 @@ adwaita_engine_render_extension (GtkThemingEngine *engine,
                                  gdouble           height,
                                  GtkPositionType   gap_side)
 {
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_EXTENSION, cr, x, y, width, height))
+    return;
+
   if (gtk_theming_engine_has_class (engine, GTK_STYLE_CLASS_NOTEBOOK) &&
       ((gap_side == GTK_POS_TOP) || (gap_side == GTK_POS_BOTTOM)))
     {
@@ -329,36 +259,15 @@ adwaita_engine_render_expander (GtkThemingEngine *engine,
 {
   GdkRGBA fg;
   GtkStateFlags state;
-  gdouble side, offset;
-  gint line_width;
+  gdouble side;
   GtkBorder border;
   const GtkWidgetPath *path = gtk_theming_engine_get_path (engine);
 
-  side = floor (MIN (width, height));
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_EXPANDER, cr, x, y, width, height))
+    return;
 
-  if (gtk_widget_path_is_type (path, GTK_TYPE_TREE_VIEW) &&
-      (side == 17))
-    {
-      /* HACK: draw the expander as if it was 11px instead of the allocated 17px,
-       * so that we can have a bit of padding between the view edge and the
-       * expander itself.
-       */
-      x += 3;
-      y += 3;
-      width -= 6;
-      height -= 6;
-      side -= 6;
-    }
-
-  x += width / 2 - side / 2;
-  y += height / 2 - side / 2;
-
-  x = floor (x);
-  y = floor (y);
-
-  /* make sure the rendered side length is always odd */
-  if (((gint) side % 2) == 0)
-    side -= 1.0;
+  side = _adwaita_fit_expander (gtk_widget_path_is_type (path, GTK_TYPE_TREE_VIEW),
+                                &x, &y, width, height);
 
   GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_background
     (engine, cr, x, y, side, side);
@@ -369,35 +278,244 @@ adwaita_engine_render_expander (GtkThemingEngine *engine,
   gtk_theming_engine_get_color (engine, state, &fg);
   gtk_theming_engine_get_border (engine, state, &border);
 
-  line_width = 1;
-  offset = (1 + line_width / 2.0);
+  _adwaita_draw_expander_sign (cr, &fg, &border,
+                               (state & GTK_STATE_FLAG_ACTIVE) != 0,
+                               x, y, side);
+}
+
+static gboolean spinner_cache_disabled = FALSE;
 
-  cairo_save (cr);
+static void
+render_spinner (GtkThemingEngine *engine,
+                cairo_t          *cr,
+                gdouble           x,
+                gdouble           y,
+                gdouble           width,
+                gdouble           height)
+{
+  GtkStateFlags state;
+  GdkRGBA color;
+  gdouble progress;
+  guint step;
+
+  state = gtk_theming_engine_get_state (engine);
+  gtk_theming_engine_get_color (engine, state, &color);
+
+  if (gtk_theming_engine_state_is_running (engine,
+                                           GTK_STATE_ACTIVE,
+                                           &progress))
+    step = (guint) (progress * SPINNER_NUM_STEPS) % SPINNER_NUM_STEPS;
+  else
+    step = 0;
+
+  _adwaita_draw_spinner (cr, &color, step, !spinner_cache_disabled,
+                         x, y, width, height);
+}
+
+static void
+adwaita_engine_render_activity (GtkThemingEngine *engine,
+                                cairo_t          *cr,
+                                gdouble           x,
+                                gdouble           y,
+                                gdouble           width,
+                                gdouble           height)
+{
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_ACTIVITY, cr, x, y, width, height))
+    return;
+
+  if (gtk_theming_engine_has_class (engine, GTK_STYLE_CLASS_SPINNER))
+    {
+      render_spinner (engine, cr, x, y, width, height);
+      return;
+    }
+
+  GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_activity
+    (engine, cr, x, y, width, height);
+}
+
+static gboolean gradient_cache_disabled = FALSE;
+
+enum {
+  CSS_AREA_BORDER_BOX,
+  CSS_AREA_PADDING_BOX,
+  CSS_AREA_CONTENT_BOX
+};
+
+static gint
+get_css_area (GtkThemingEngine *engine,
+              GtkStateFlags     state,
+              const gchar      *property)
+{
+  GValue value = { 0, };
+  gint area = CSS_AREA_CONTENT_BOX;
+
+  gtk_theming_engine_get_property (engine, property, state, &value);
+
+  if (G_VALUE_HOLDS_ENUM (&value))
+    area = g_value_get_enum (&value);
+
+  if (G_IS_VALUE (&value))
+    g_value_unset (&value);
+
+  return area;
+}
+
+static gboolean
+is_state_running (GtkThemingEngine *engine)
+{
+  GtkStateType state;
 
-  cairo_set_line_width (cr, line_width);
-  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-  gdk_cairo_set_source_rgba (cr, &fg);
+  for (state = GTK_STATE_ACTIVE; state <= GTK_STATE_FOCUSED; state++)
+    if (gtk_theming_engine_state_is_running (engine, state, NULL))
+      return TRUE;
 
-  cairo_move_to (cr,
-                 x + border.left + offset,
-                 y + side / 2);
-  cairo_line_to (cr,
-                 x + side - (border.right + offset),
-                 y + side / 2);
+  return FALSE;
+}
+
+static gboolean
+render_cached_gradient (GtkThemingEngine *engine,
+                        cairo_t          *cr,
+                        gdouble           x,
+                        gdouble           y,
+                        gdouble           width,
+                        gdouble           height)
+{
+  cairo_pattern_t *pattern = NULL;
+  cairo_surface_t *strip;
+  GtkStateFlags state;
+  GtkBorder border;
+  GdkRGBA bg_color;
+  gdouble scale, origin_y, origin_height, paint_y, paint_height, extent;
+  gboolean cached_background = FALSE;
+  gint radius = 0;
+
+  /* Neither the box-shadow nor the radius of each corner can be read
+   * back here, so the stylesheet has to vouch for both; squared
+   * junction corners make the radii differ as well.
+   */
+  state = gtk_theming_engine_get_state (engine);
+  gtk_theming_engine_get (engine, state,
+                          "-adwaita-cached-background", &cached_background,
+                          NULL);
+
+  if (!cached_background || gtk_theming_engine_get_junction_sides (engine) != 0)
+    return FALSE;
+
+  scale = _adwaita_get_pixel_aligned_scale (cr, x, y);
+  if (scale == 0 ||
+      width * scale != floor (width * scale) ||
+      height * scale != floor (height * scale))
+    return FALSE;
+
+  gtk_theming_engine_get (engine, state,
+                          "background-image", &pattern,
+                          GTK_STYLE_PROPERTY_BORDER_RADIUS, &radius,
+                          NULL);
+
+  if (pattern == NULL)
+    return FALSE;
+
+  /* the columns holding the corners and side borders */
+  gtk_theming_engine_get_border (engine, state, &border);
+  extent = radius + MAX (border.left, border.right);
+
+  if (width < 3 * extent || is_state_running (engine))
+    {
+      cairo_pattern_destroy (pattern);
+      return FALSE;
+    }
+
+  /* the background is painted over the clip box... */
+  switch (get_css_area (engine, state, "background-clip"))
+    {
+    case CSS_AREA_BORDER_BOX:
+      paint_y = y;
+      paint_height = height;
+      break;
+    case CSS_AREA_PADDING_BOX:
+      paint_y = y + border.top;
+      paint_height = height - border.top - border.bottom;
+      break;
+    default:
+      cairo_pattern_destroy (pattern);
+      return FALSE;
+    }
+
+  /* ...and the gradient sized to the origin box */
+#if GTK_CHECK_VERSION (3, 5, 0)
+  switch (get_css_area (engine, state, "background-origin"))
+    {
+    case CSS_AREA_BORDER_BOX:
+      origin_y = y;
+      origin_height = height;
+      break;
+    case CSS_AREA_PADDING_BOX:
+      origin_y = y + border.top;
+      origin_height = height - border.top - border.bottom;
+      break;
+    default:
+      cairo_pattern_destroy (pattern);
+      return FALSE;
+    }
+#else
+  origin_y = y;
+  origin_height = height;
+#endif
+
+  strip = NULL;
+  if (paint_height > 0 && origin_height > 0)
+    strip = _adwaita_get_gradient_strip (pattern, origin_height, scale);
+
+  cairo_pattern_destroy (pattern);
+
+  if (strip == NULL)
+    return FALSE;
 
-  if ((state & GTK_STATE_FLAG_ACTIVE) == 0)
+  /* the parent class renders the ends, with their rounded corners */
+  if (extent > 0)
     {
-      cairo_move_to (cr,
-                     x + side / 2,
-                     y + border.top + offset);
-      cairo_line_to (cr,
-                     x + side / 2,
-                     y + side - (border.bottom + offset));
+      cairo_save (cr);
+      cairo_rectangle (cr, x, y, extent, height);
+      cairo_rectangle (cr, x + width - extent, y, extent, height);
+      cairo_clip (cr);
+      GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_background
+        (engine, cr, x, y, width, height);
+      cairo_restore (cr);
     }
 
-  cairo_stroke (cr);
+  cairo_save (cr);
+  cairo_rectangle (cr, x + extent, paint_y, width - 2 * extent, paint_height);
+  cairo_clip (cr);
+
+  gtk_theming_engine_get_background_color (engine, state, &bg_color);
+  gdk_cairo_set_source_rgba (cr, &bg_color);
+  cairo_paint (cr);
+
+  _adwaita_paint_gradient_strip (cr, strip, scale, x, origin_y);
 
   cairo_restore (cr);
+  cairo_surface_destroy (strip);
+
+  return TRUE;
+}
+
+static void
+adwaita_engine_render_background (GtkThemingEngine *engine,
+                                  cairo_t          *cr,
+                                  gdouble           x,
+                                  gdouble           y,
+                                  gdouble           width,
+                                  gdouble           height)
+{
+  if (_adwaita_render_is_culled (ADWAITA_VFUNC_BACKGROUND, cr, x, y, width, height))
+    return;
+
+  if (!gradient_cache_disabled &&
+      render_cached_gradient (engine, cr, x, y, width, height))
+    return;
+
+  GTK_THEMING_ENGINE_CLASS (adwaita_engine_parent_class)->render_background
+    (engine, cr, x, y, width, height);
 }
 
 static void
@@ -409,6 +527,11 @@ adwaita_engine_class_init (AdwaitaEngineClass *klass)
   engine_class->render_focus = adwaita_engine_render_focus;
   engine_class->render_extension = adwaita_engine_render_extension;
   engine_class->render_expander = adwaita_engine_render_expander;
+  engine_class->render_activity = adwaita_engine_render_activity;
+  engine_class->render_background = adwaita_engine_render_background;
+
+  spinner_cache_disabled = (g_getenv ("ADWAITA_DISABLE_SPINNER_CACHE") != NULL);
+  gradient_cache_disabled = (g_getenv ("ADWAITA_DISABLE_GRADIENT_CACHE") != NULL);
 
   gtk_theming_engine_register_property (ADWAITA_NAMESPACE, NULL,
                                         g_param_spec_boxed ("focus-border-color",
@@ -431,6 +554,18 @@ adwaita_engine_class_init (AdwaitaEngineClass *klass)
                                                               "Focus border uses dashes",
                                                               "Focus border uses dashes",
                                                               FALSE, 0));
+  gtk_theming_engine_register_property (ADWAITA_NAMESPACE, NULL,
+                                        g_param_spec_boolean ("cached-background",
+                                                              "Cached background",
+                                                              "The background is a vertical gradient with the same radius on every corner and no box-shadow",
+                                                              FALSE, 0));
+  gtk_theming_engine_register_property (ADWAITA_NAMESPACE, NULL,
+                                        g_param_spec_enum ("render-quality",
+                                                           "Render quality",
+                                                           "Trade rendering quality for speed",
+                                                           ADWAITA_TYPE_RENDER_QUALITY,
+                                                           ADWAITA_RENDER_QUALITY_BEST,
+                                                           0));
 }
 
 static void
@@ -438,6 +573,112 @@ adwaita_engine_class_finalize (AdwaitaEngineClass *klass)
 {
 }
 
+/* With ADWAITA_WARM_UP_SPINNERS set, the engine fills its spinner
+ * cache while the application is still starting up: an idle looks up
+ * the colour of an active spinner, which is the state spinners are
+ * drawn in, and a worker thread renders the frames of the common
+ * spinner sizes with it. Spinners are the only elements whose
+ * rendering is cached, so they are the only ones it warms up.
+ */
+static const gint spinner_warm_up_sizes[] = {
+  16, 24, 32
+};
+
+typedef struct {
+  gdouble scale;
+  GdkRGBA color;
+  gint spinner_size;
+} SpinnerWarmUpTask;
+
+static GThreadPool *spinner_warm_up_pool = NULL;
+static guint spinner_warm_up_idle_id = 0;
+static gdouble spinner_warm_up_scale = 1;
+
+static void
+spinner_warm_up_thread_func (gpointer data,
+                             gpointer user_data)
+{
+  SpinnerWarmUpTask *task = data;
+
+  _adwaita_cache_spinner_frames (&task->color, task->spinner_size, task->scale);
+  g_slice_free (SpinnerWarmUpTask, task);
+}
+
+static gboolean
+spinner_warm_up_idle (gpointer user_data)
+{
+  GtkStyleContext *context;
+  GtkWidgetPath *path;
+  SpinnerWarmUpTask *task;
+  GdkRGBA color;
+  guint i;
+
+  path = gtk_widget_path_new ();
+  gtk_widget_path_append_type (path, GTK_TYPE_WINDOW);
+  gtk_widget_path_append_type (path, GTK_TYPE_SPINNER);
+  gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_SPINNER);
+
+  context = gtk_style_context_new ();
+  gtk_style_context_set_path (context, path);
+  gtk_widget_path_free (path);
+
+  gtk_style_context_get_color (context, GTK_STATE_FLAG_ACTIVE, &color);
+  g_object_unref (context);
+
+  for (i = 0; i < G_N_ELEMENTS (spinner_warm_up_sizes); i++)
+    {
+      task = g_slice_new (SpinnerWarmUpTask);
+      task->scale = spinner_warm_up_scale;
+      task->color = color;
+      task->spinner_size = spinner_warm_up_sizes[i];
+
+      g_thread_pool_push (spinner_warm_up_pool, task, NULL);
+    }
+
+  spinner_warm_up_idle_id = 0;
+
+  return FALSE;
+}
+
+static void
+start_spinner_warm_up (void)
+{
+#if GTK_CHECK_VERSION (3, 10, 0)
+  GdkScreen *screen;
+
+  screen = gdk_screen_get_default ();
+  if (screen != NULL)
+    spinner_warm_up_scale = gdk_screen_get_monitor_scale_factor (screen, 0);
+#endif
+
+  spinner_warm_up_pool = g_thread_pool_new (spinner_warm_up_thread_func, NULL,
+                                            1, FALSE, NULL);
+
+  /* the theme is still being parsed when the engine is created, so
+   * style lookups have to wait for the main loop
+   */
+  spinner_warm_up_idle_id = g_idle_add (spinner_warm_up_idle, NULL);
+}
+
+static void
+stop_spinner_warm_up (void)
+{
+  if (spinner_warm_up_idle_id != 0)
+    {
+      g_source_remove (spinner_warm_up_idle_id);
+      spinner_warm_up_idle_id = 0;
+    }
+
+  /* the module is about to be unloaded, so the thread has to be done;
+   * the few queued tasks are run rather than leaked
+   */
+  if (spinner_warm_up_pool != NULL)
+    {
+      g_thread_pool_free (spinner_warm_up_pool, FALSE, TRUE);
+      spinner_warm_up_pool = NULL;
+    }
+}
+
 G_MODULE_EXPORT void
 theme_init (GTypeModule *module)
 {
@@ -447,11 +688,66 @@ theme_init (GTypeModule *module)
 G_MODULE_EXPORT void
 theme_exit (void)
 {
+  stop_spinner_warm_up ();
+  _adwaita_cache_free ();
+}
+
+/* Number of calls of the given vfunc that were skipped because they
+ * were entirely outside the clip, and of those that were drawn.
+ */
+G_MODULE_EXPORT gboolean
+adwaita_engine_get_render_stats (const gchar *vfunc_name,
+                                 guint       *culled,
+                                 guint       *drawn)
+{
+  return _adwaita_render_stats_get (vfunc_name, culled, drawn);
+}
+
+G_MODULE_EXPORT void
+adwaita_engine_reset_render_stats (void)
+{
+  _adwaita_render_stats_reset ();
+}
+
+/* Lookups in the cache shared by all engine instances, its size in
+ * bytes and the budget it's kept under.
+ */
+G_MODULE_EXPORT void
+adwaita_engine_get_cache_stats (guint *hits,
+                                guint *misses,
+                                guint *evictions,
+                                gsize *size,
+                                gsize *budget)
+{
+  AdwaitaCacheStats stats;
+
+  _adwaita_cache_get_stats (&stats);
+
+  if (hits != NULL)
+    *hits = stats.hits;
+  if (misses != NULL)
+    *misses = stats.misses;
+  if (evictions != NULL)
+    *evictions = stats.evictions;
+  if (size != NULL)
+    *size = stats.size;
+  if (budget != NULL)
+    *budget = stats.budget;
 }
 
 G_MODULE_EXPORT GtkThemingEngine *
 create_engine (void)
 {
+  _adwaita_cache_watch (gtk_settings_get_default ());
+
+  /* the class isn't initialized yet on the first call, so
+   * spinner_cache_disabled can't be used here
+   */
+  if (spinner_warm_up_pool == NULL &&
+      g_getenv ("ADWAITA_WARM_UP_SPINNERS") != NULL &&
+      g_getenv ("ADWAITA_DISABLE_SPINNER_CACHE") == NULL)
+    start_spinner_warm_up ();
+
   return GTK_THEMING_ENGINE (g_object_new (ADWAITA_TYPE_ENGINE,
                                            "name", "adwaita",
                                            NULL));
@@ -0,0 +1,676 @@
+/* Theme preview renderer
+ *
+ * Renders thumbnails of the arrows, focus rings, notebook tabs,
+ * expanders and spinners drawn by the Adwaita engine, for every
+ * combination of theme, state and size. The thumbnails that are
+ * written out are drawn by the engine GTK+ loaded for the theme,
+ * through gtk_render_*() on a style context, on the main thread.
+ *
+ * GTK+ can't be used from other threads, but the engine only goes
+ * through it to look up the style; the drawing itself is done by the
+ * _adwaita_draw_*() functions, which only use the cairo context and
+ * the values they are given. Those are then run again on a pool with a
+ * thread per core, each thumbnail on its own image surface, with the
+ * values looked up on the main thread. Where GTK+ itself draws part of
+ * an element (the background of tabs, the box of expanders) the
+ * threads only draw the engine's part, over a flat background.
+ *
+ * Every threaded drawing is compared with the same drawing done
+ * serially beforehand; arrows, focus rings and spinners, which the
+ * engine draws entirely with those functions, are also compared with
+ * what gtk_render_*() drew. With --stress, every thumbnail is drawn N
+ * times concurrently. 'make preview-tsan' runs that on a copy of the
+ * tool built with ThreadSanitizer; set ADWAITA_CACHE_BUDGET to a few
+ * kilobytes to also exercise cache evictions under contention.
+ *
+ * No window is shown, but GTK+ still needs a display to load the
+ * themes; run it under Xvfb or the broadway backend on machines
+ * without one.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adwaita_utils.h"
+
+typedef struct {
+  const gchar *name;
+  const gchar *css;
+} ThemeInfo;
+
+static const ThemeInfo themes[] = {
+  { "Adwaita", "Adwaita/gtk-3.0/gtk.css" },
+  { "Adwaita-dark", "Adwaita/gtk-3.0/gtk-dark.css" },
+  { "HighContrast", "HighContrast/gtk-3.0/gtk.css" },
+  { "HighContrastInverse", "HighContrastInverse/gtk-3.0/gtk.css" },
+  { "LowContrast", "LowContrast/gtk-3.0/gtk.css" }
+};
+
+static const gchar *resources[] = {
+  "Adwaita/gtk-3.0/gtk.gresource",
+  "HighContrast/gtk-3.0/gtk.gresource",
+  "HighContrastInverse/gtk-3.0/gtk.gresource"
+};
+
+typedef enum {
+  ELEMENT_ARROW,
+  ELEMENT_FOCUS,
+  ELEMENT_TAB,
+  ELEMENT_EXPANDER,
+  ELEMENT_SPINNER,
+  N_ELEMENTS
+} ElementType;
+
+static const gchar *element_names[N_ELEMENTS] = {
+  "arrow", "focus", "tab", "expander", "spinner"
+};
+
+static const struct {
+  GtkStateFlags flags;
+  const gchar *name;
+} states[] = {
+  { GTK_STATE_FLAG_NORMAL, "normal" },
+  { GTK_STATE_FLAG_PRELIGHT, "prelight" },
+  { GTK_STATE_FLAG_ACTIVE, "active" },
+  { GTK_STATE_FLAG_INSENSITIVE, "insensitive" },
+  { GTK_STATE_FLAG_SELECTED, "selected" },
+  { GTK_STATE_FLAG_BACKDROP, "backdrop" }
+};
+
+static const gint sizes[] = {
+  8, 12, 16, 24, 32, 48
+};
+
+/* Space around each element in the thumbnail */
+#define MARGIN 4
+
+typedef struct {
+  const ThemeInfo *theme;
+  ElementType type;
+  gint state;
+  gint size;
+  gint width;
+  gint height;
+
+  /* shared by the jobs of a theme and element */
+  GtkStyleContext *context;
+
+  /* looked up on the main thread, as the engine does */
+  AdwaitaRenderQuality quality;
+  GdkRGBA color;
+  GdkRGBA background_color;
+  GdkRGBA border_color;
+  GdkRGBA *focus_color;
+  GtkBorder border;
+  cairo_pattern_t *border_gradient;
+  gint focus_radius;
+  gint focus_line_width;
+  gboolean focus_dashes;
+  gint tab_curvature;
+
+  /* of the drawing by the engine through GTK+ */
+  gchar *reference;
+  /* of the serial drawing by the _adwaita_draw_*() functions */
+  gchar *checksum;
+} Job;
+
+static gint n_threads = 0;
+static gint stress_rounds = 0;
+static gchar *output_dir = NULL;
+static gchar **theme_names = NULL;
+
+static GOptionEntry entries[] = {
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir,
+    "Write the thumbnails as PNG files to DIR", "DIR" },
+  { "theme", 't', 0, G_OPTION_ARG_STRING_ARRAY, &theme_names,
+    "Only render the given theme (can be repeated)", "NAME" },
+  { "threads", 'j', 0, G_OPTION_ARG_INT, &n_threads,
+    "Number of drawing threads, one per core by default", "N" },
+  { "stress", 's', 0, G_OPTION_ARG_INT, &stress_rounds,
+    "Draw every thumbnail N times concurrently and check the results", "N" },
+  { NULL }
+};
+
+static gboolean use_spinner_cache = TRUE;
+static gint mismatches = 0;
+
+static GtkStyleContext *
+create_context (GtkStyleProvider *provider,
+                ElementType       type)
+{
+  GtkStyleContext *context;
+  GtkWidgetPath *path;
+
+  path = gtk_widget_path_new ();
+  gtk_widget_path_append_type (path, GTK_TYPE_WINDOW);
+
+  switch (type)
+    {
+    case ELEMENT_ARROW:
+    case ELEMENT_FOCUS:
+      gtk_widget_path_append_type (path, GTK_TYPE_BUTTON);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_BUTTON);
+      break;
+    case ELEMENT_TAB:
+      gtk_widget_path_append_type (path, GTK_TYPE_NOTEBOOK);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_NOTEBOOK);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_TOP);
+      gtk_widget_path_iter_add_region (path, -1, GTK_STYLE_REGION_TAB,
+                                       GTK_REGION_EVEN | GTK_REGION_FIRST);
+      break;
+    case ELEMENT_EXPANDER:
+      gtk_widget_path_append_type (path, GTK_TYPE_TREE_VIEW);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_VIEW);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_EXPANDER);
+      break;
+    case ELEMENT_SPINNER:
+      gtk_widget_path_append_type (path, GTK_TYPE_SPINNER);
+      gtk_widget_path_iter_add_class (path, -1, GTK_STYLE_CLASS_SPINNER);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  context = gtk_style_context_new ();
+  gtk_style_context_set_path (context, path);
+  gtk_style_context_add_provider (context, provider,
+                                  GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+  gtk_widget_path_free (path);
+
+  return context;
+}
+
+static gboolean
+uses_adwaita_engine (GtkStyleProvider *provider)
+{
+  GtkStyleContext *context;
+  GtkThemingEngine *engine = NULL;
+  gchar *name = NULL;
+  gboolean retval;
+
+  context = create_context (provider, ELEMENT_ARROW);
+  gtk_style_context_get (context, GTK_STATE_FLAG_NORMAL,
+                         "engine", &engine,
+                         NULL);
+
+  if (engine != NULL)
+    {
+      g_object_get (engine, "name", &name, NULL);
+      g_object_unref (engine);
+    }
+
+  retval = (g_strcmp0 (name, "adwaita") == 0);
+
+  g_object_unref (context);
+  g_free (name);
+
+  return retval;
+}
+
+/* The same lookups as the engine's vfuncs do */
+static void
+lookup_style (Job *job)
+{
+  GtkStyleContext *context = job->context;
+  GtkStateFlags state = states[job->state].flags;
+
+  /* style properties are looked up in the current state */
+  gtk_style_context_save (context);
+  gtk_style_context_set_state (context, state);
+
+  gtk_style_context_get_color (context, state, &job->color);
+  gtk_style_context_get_background_color (context, state, &job->background_color);
+  gtk_style_context_get_border_color (context, state, &job->border_color);
+  gtk_style_context_get_border (context, state, &job->border);
+  gtk_style_context_get (context, state,
+                         "-adwaita-render-quality", &job->quality,
+                         "-adwaita-border-gradient", &job->border_gradient,
+                         "-adwaita-focus-border-color", &job->focus_color,
+                         "-adwaita-focus-border-radius", &job->focus_radius,
+                         "-adwaita-focus-border-dashes", &job->focus_dashes,
+                         NULL);
+  gtk_style_context_get_style (context,
+                               "focus-line-width", &job->focus_line_width,
+                               NULL);
+
+  if (job->type == ELEMENT_TAB)
+    gtk_style_context_get_style (context,
+                                 "tab-curvature", &job->tab_curvature,
+                                 NULL);
+
+  gtk_style_context_restore (context);
+}
+
+static void
+job_free (Job *job)
+{
+  if (job->focus_color != NULL)
+    gdk_rgba_free (job->focus_color);
+  if (job->border_gradient != NULL)
+    cairo_pattern_destroy (job->border_gradient);
+
+  g_object_unref (job->context);
+  g_free (job->reference);
+  g_free (job->checksum);
+  g_slice_free (Job, job);
+}
+
+static GList *
+create_jobs (const ThemeInfo *theme,
+             GList           *jobs)
+{
+  GtkCssProvider *provider;
+  GtkStyleContext *context;
+  GError *error = NULL;
+  Job *job;
+  gchar *path;
+  gint type;
+  guint state, size;
+
+  provider = gtk_css_provider_new ();
+  path = g_build_filename (THEMES_SRCDIR, theme->css, NULL);
+
+  if (!gtk_css_provider_load_from_path (provider, path, &error))
+    g_error ("Unable to load %s: %s", path, error->message);
+
+  g_free (path);
+
+  if (!uses_adwaita_engine (GTK_STYLE_PROVIDER (provider)))
+    {
+      g_printerr ("Skipping %s, which isn't drawn by the adwaita engine\n",
+                  theme->name);
+      g_object_unref (provider);
+      return jobs;
+    }
+
+  for (type = 0; type < N_ELEMENTS; type++)
+    {
+      context = create_context (GTK_STYLE_PROVIDER (provider), type);
+
+      for (state = 0; state < G_N_ELEMENTS (states); state++)
+        for (size = 0; size < G_N_ELEMENTS (sizes); size++)
+          {
+            job = g_slice_new0 (Job);
+            job->theme = theme;
+            job->type = type;
+            job->state = state;
+            job->size = sizes[size];
+            job->context = g_object_ref (context);
+
+            switch (type)
+              {
+              case ELEMENT_FOCUS:
+                job->width = 3 * job->size + 2 * MARGIN;
+                job->height = job->size + 2 * MARGIN;
+                break;
+              case ELEMENT_TAB:
+                job->width = 4 * job->size + 2 * MARGIN;
+                job->height = job->size + 8 + 2 * MARGIN;
+                break;
+              default:
+                job->width = job->size + 2 * MARGIN;
+                job->height = job->size + 2 * MARGIN;
+                break;
+              }
+
+            jobs = g_list_prepend (jobs, job);
+          }
+
+      g_object_unref (context);
+    }
+
+  g_object_unref (provider);
+
+  return jobs;
+}
+
+static void
+render_element (cairo_t *cr,
+                Job     *job)
+{
+  GtkStyleContext *context = job->context;
+
+  gtk_style_context_save (context);
+  gtk_style_context_set_state (context, states[job->state].flags);
+
+  switch (job->type)
+    {
+    case ELEMENT_ARROW:
+      gtk_render_arrow (context, cr, G_PI, MARGIN, MARGIN, job->size);
+      break;
+    case ELEMENT_FOCUS:
+      gtk_render_focus (context, cr, MARGIN, MARGIN,
+                        job->width - 2 * MARGIN, job->height - 2 * MARGIN);
+      break;
+    case ELEMENT_TAB:
+      gtk_render_extension (context, cr, MARGIN, MARGIN,
+                            job->width - 2 * MARGIN, job->height - 2 * MARGIN,
+                            GTK_POS_BOTTOM);
+      break;
+    case ELEMENT_EXPANDER:
+      gtk_render_expander (context, cr, MARGIN, MARGIN, job->size, job->size);
+      break;
+    case ELEMENT_SPINNER:
+      gtk_render_activity (context, cr, MARGIN, MARGIN, job->size, job->size);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  gtk_style_context_restore (context);
+}
+
+/* Stands in for the background GTK+ draws under the tab */
+static void
+draw_flat_background (cairo_t *cr,
+                      gdouble  x,
+                      gdouble  y,
+                      gdouble  width,
+                      gdouble  height,
+                      gpointer user_data)
+{
+  Job *job = user_data;
+
+  gdk_cairo_set_source_rgba (cr, &job->background_color);
+  cairo_paint (cr);
+}
+
+/* Draws the element with the engine's drawing functions only, which
+ * is safe from any thread
+ */
+static void
+draw_element (cairo_t *cr,
+              Job     *job)
+{
+  gdouble x = MARGIN, y = MARGIN, side;
+
+  switch (job->type)
+    {
+    case ELEMENT_ARROW:
+      _adwaita_draw_arrow (cr, job->quality, &job->color,
+                           G_PI, x, y, job->size);
+      break;
+    case ELEMENT_FOCUS:
+      _adwaita_draw_focus (cr, job->quality, job->focus_color,
+                           job->focus_radius, job->focus_dashes,
+                           job->focus_line_width,
+                           x, y, job->width - 2 * MARGIN, job->height - 2 * MARGIN);
+      break;
+    case ELEMENT_TAB:
+      _adwaita_draw_notebook_tab (cr, job->quality, job->tab_curvature,
+                                  GTK_POS_BOTTOM,
+                                  (states[job->state].flags & GTK_STATE_FLAG_ACTIVE) != 0,
+                                  &job->border_color, job->border_gradient,
+                                  draw_flat_background, job,
+                                  x, y, job->width - 2 * MARGIN, job->height - 2 * MARGIN);
+      break;
+    case ELEMENT_EXPANDER:
+      side = _adwaita_fit_expander (TRUE, &x, &y, job->size, job->size);
+      _adwaita_draw_expander_sign (cr, &job->color, &job->border,
+                                   (states[job->state].flags & GTK_STATE_FLAG_ACTIVE) != 0,
+                                   x, y, side);
+      break;
+    case ELEMENT_SPINNER:
+      /* a style context without a widget never runs the animation */
+      _adwaita_draw_spinner (cr, &job->color, 0, use_spinner_cache,
+                             x, y, job->size, job->size);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static gboolean
+is_drawn_by_engine_only (Job *job)
+{
+  return (job->type == ELEMENT_ARROW ||
+          job->type == ELEMENT_FOCUS ||
+          job->type == ELEMENT_SPINNER);
+}
+
+static gchar *
+render_job (Job              *job,
+            gboolean          through_gtk,
+            cairo_surface_t **surface_out)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  gchar *checksum;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, job->width, job->height);
+  cr = cairo_create (surface);
+
+  if (through_gtk)
+    render_element (cr, job);
+  else
+    draw_element (cr, job);
+
+  cairo_destroy (cr);
+
+  cairo_surface_flush (surface);
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_MD5,
+                                          cairo_image_surface_get_data (surface),
+                                          cairo_image_surface_get_stride (surface) *
+                                          job->height);
+
+  if (surface_out != NULL)
+    *surface_out = surface;
+  else
+    cairo_surface_destroy (surface);
+
+  return checksum;
+}
+
+static void
+write_job (Job             *job,
+           cairo_surface_t *surface)
+{
+  gchar *name, *path;
+
+  name = g_strdup_printf ("%s-%s-%s-%d.png",
+                          job->theme->name, element_names[job->type],
+                          states[job->state].name, job->size);
+  path = g_build_filename (output_dir, name, NULL);
+
+  if (cairo_surface_write_to_png (surface, path) != CAIRO_STATUS_SUCCESS)
+    g_printerr ("Unable to write %s\n", path);
+
+  g_free (name);
+  g_free (path);
+}
+
+static void
+render_thread_func (gpointer data,
+                    gpointer user_data)
+{
+  Job *job = data;
+  gchar *checksum;
+
+  checksum = render_job (job, FALSE, NULL);
+
+  if (strcmp (checksum, job->checksum) != 0)
+    {
+      g_printerr ("%s %s %s %d differs from the serial rendering\n",
+                  job->theme->name, element_names[job->type],
+                  states[job->state].name, job->size);
+      g_atomic_int_inc (&mismatches);
+    }
+
+  g_free (checksum);
+}
+
+static gint
+get_n_processors (void)
+{
+#if GLIB_CHECK_VERSION (2, 36, 0)
+  return g_get_num_processors ();
+#else
+  return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#endif
+}
+
+static gboolean
+is_theme_selected (const ThemeInfo *theme)
+{
+  gint i;
+
+  if (theme_names == NULL)
+    return TRUE;
+
+  for (i = 0; theme_names[i] != NULL; i++)
+    if (strcmp (theme_names[i], theme->name) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GThreadPool *pool;
+  GResource *resource;
+  GError *error = NULL;
+  GTimer *timer;
+  AdwaitaCacheStats stats;
+  GList *jobs = NULL, *l;
+  cairo_surface_t *surface;
+  gchar *path;
+  gint pass, n_jobs;
+  guint i;
+
+  context = g_option_context_new ("- render thumbnails of the engine's elements in every theme");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (n_threads <= 0)
+    n_threads = get_n_processors ();
+
+  /* the same choice as the engine makes */
+  use_spinner_cache = (g_getenv ("ADWAITA_DISABLE_SPINNER_CACHE") == NULL);
+
+  /* keep the installed theme out of the lookups */
+  g_object_set (gtk_settings_get_default (),
+                "gtk-theme-name", "Raleigh",
+                NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (resources); i++)
+    {
+      path = g_build_filename (THEMES_BUILDDIR, resources[i], NULL);
+      resource = g_resource_load (path, &error);
+
+      if (resource == NULL)
+        g_error ("Unable to load %s: %s", path, error->message);
+
+      g_resources_register (resource);
+      g_free (path);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (themes); i++)
+    if (is_theme_selected (&themes[i]))
+      jobs = create_jobs (&themes[i], jobs);
+
+  jobs = g_list_reverse (jobs);
+  n_jobs = g_list_length (jobs);
+
+  if (output_dir != NULL && g_mkdir_with_parents (output_dir, 0755) != 0)
+    {
+      g_printerr ("Unable to create %s\n", output_dir);
+      return 1;
+    }
+
+  timer = g_timer_new ();
+
+  for (l = jobs; l != NULL; l = l->next)
+    {
+      Job *job = l->data;
+
+      surface = NULL;
+      job->reference = render_job (job, TRUE, output_dir != NULL ? &surface : NULL);
+
+      if (surface != NULL)
+        {
+          write_job (job, surface);
+          cairo_surface_destroy (surface);
+        }
+    }
+
+  g_print ("%d thumbnails drawn through GTK+ in %.2f ms\n",
+           n_jobs, 1000.0 * g_timer_elapsed (timer, NULL));
+
+  for (l = jobs; l != NULL; l = l->next)
+    {
+      Job *job = l->data;
+
+      lookup_style (job);
+    }
+
+  /* from here on GTK+ isn't used anymore, only the drawing code */
+  g_timer_start (timer);
+
+  for (l = jobs; l != NULL; l = l->next)
+    {
+      Job *job = l->data;
+
+      job->checksum = render_job (job, FALSE, NULL);
+
+      if (is_drawn_by_engine_only (job) &&
+          strcmp (job->checksum, job->reference) != 0)
+        {
+          g_printerr ("%s %s %s %d differs from the rendering through GTK+\n",
+                      job->theme->name, element_names[job->type],
+                      states[job->state].name, job->size);
+          mismatches++;
+        }
+    }
+
+  g_print ("%d thumbnails drawn serially in %.2f ms\n",
+           n_jobs, 1000.0 * g_timer_elapsed (timer, NULL));
+
+  /* start over with an empty cache, so that threads race to fill it */
+  _adwaita_cache_invalidate ();
+  g_timer_start (timer);
+
+  pool = g_thread_pool_new (render_thread_func, NULL, n_threads, TRUE, &error);
+  if (pool == NULL)
+    g_error ("Unable to create the thread pool: %s", error->message);
+
+  pass = 0;
+
+  do
+    {
+      for (l = jobs; l != NULL; l = l->next)
+        g_thread_pool_push (pool, l->data, NULL);
+    }
+  while (++pass < stress_rounds);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  g_print ("%d thumbnails drawn in %.2f ms on %d threads\n",
+           n_jobs * pass, 1000.0 * g_timer_elapsed (timer, NULL), n_threads);
+  g_print ("%d differed from the reference renderings\n",
+           g_atomic_int_get (&mismatches));
+
+  _adwaita_cache_get_stats (&stats);
+  g_print ("cache: %u hits, %u misses, %u evictions, %u entries in %" G_GSIZE_FORMAT
+           " of %" G_GSIZE_FORMAT " kB\n",
+           stats.hits, stats.misses, stats.evictions, stats.n_entries,
+           stats.size / 1024, stats.budget / 1024);
+
+  g_list_free_full (jobs, (GDestroyNotify) job_free);
+  g_timer_destroy (timer);
+  _adwaita_cache_free ();
+
+  return g_atomic_int_get (&mismatches) > 0 ? 1 : 0;
+}
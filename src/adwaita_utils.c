@@ -23,17 +23,159 @@
  * Project contact: <gnome-themes-list@gnome.org>
  */
 
+#include <string.h>
+#include <math.h>
+
 #include "adwaita_utils.h"
 
+/* Extra device pixels around an element's box, to account for
+ * antialiasing and strokes straddling its edges.
+ */
+#define CULL_MARGIN 2.0
+
+static const gchar *vfunc_names[ADWAITA_N_VFUNCS] = {
+  "render_arrow",
+  "render_focus",
+  "render_extension",
+  "render_expander",
+  "render_activity",
+  "render_background"
+};
+
+/* Updated atomically, as elements may be drawn from several threads */
+static gint culled_calls[ADWAITA_N_VFUNCS] = { 0, };
+static gint drawn_calls[ADWAITA_N_VFUNCS] = { 0, };
+
+static void
+rectangle_to_device_extents (cairo_t *cr,
+                             gdouble  x1,
+                             gdouble  y1,
+                             gdouble  x2,
+                             gdouble  y2,
+                             gdouble *extents)
+{
+  gdouble xs[4] = { x1, x2, x1, x2 };
+  gdouble ys[4] = { y1, y1, y2, y2 };
+  gint i;
+
+  for (i = 0; i < 4; i++)
+    {
+      cairo_user_to_device (cr, &xs[i], &ys[i]);
+
+      if (i == 0 || xs[i] < extents[0])
+        extents[0] = xs[i];
+      if (i == 0 || ys[i] < extents[1])
+        extents[1] = ys[i];
+      if (i == 0 || xs[i] > extents[2])
+        extents[2] = xs[i];
+      if (i == 0 || ys[i] > extents[3])
+        extents[3] = ys[i];
+    }
+}
+
+/* Returns TRUE if the element at the given position lies entirely
+ * outside the current clip of @cr, in which case the caller can skip
+ * rendering it altogether.
+ */
+gboolean
+_adwaita_render_is_culled (AdwaitaVFunc      vfunc,
+                           cairo_t          *cr,
+                           gdouble           x,
+                           gdouble           y,
+                           gdouble           width,
+                           gdouble           height)
+{
+  gdouble clip[4], element[4];
+  gboolean culled;
+
+  cairo_clip_extents (cr, &clip[0], &clip[1], &clip[2], &clip[3]);
+  rectangle_to_device_extents (cr, clip[0], clip[1], clip[2], clip[3], clip);
+  rectangle_to_device_extents (cr, x, y, x + width, y + height, element);
+
+  culled = (element[2] + CULL_MARGIN <= clip[0] ||
+            element[0] - CULL_MARGIN >= clip[2] ||
+            element[3] + CULL_MARGIN <= clip[1] ||
+            element[1] - CULL_MARGIN >= clip[3]);
+
+  if (culled)
+    g_atomic_int_inc (&culled_calls[vfunc]);
+  else
+    g_atomic_int_inc (&drawn_calls[vfunc]);
+
+  return culled;
+}
+
+gboolean
+_adwaita_render_stats_get (const gchar      *vfunc_name,
+                           guint            *culled,
+                           guint            *drawn)
+{
+  gint i;
+
+  for (i = 0; i < ADWAITA_N_VFUNCS; i++)
+    {
+      if (g_strcmp0 (vfunc_name, vfunc_names[i]) != 0)
+        continue;
+
+      if (culled != NULL)
+        *culled = g_atomic_int_get (&culled_calls[i]);
+      if (drawn != NULL)
+        *drawn = g_atomic_int_get (&drawn_calls[i]);
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
 void
-_cairo_round_rectangle_sides (cairo_t          *cr,
-                              gdouble           radius,
-                              gdouble           x,
-                              gdouble           y,
-                              gdouble           width,
-                              gdouble           height,
-                              guint             sides,
-                              GtkJunctionSides  junction)
+_adwaita_render_stats_reset (void)
+{
+  gint i;
+
+  for (i = 0; i < ADWAITA_N_VFUNCS; i++)
+    {
+      g_atomic_int_set (&culled_calls[i], 0);
+      g_atomic_int_set (&drawn_calls[i], 0);
+    }
+}
+
+/* Adds a corner arc to the path, or with @chamfer a straight line
+ * through its endpoints, which is much cheaper to rasterize.
+ */
+static void
+corner_arc (cairo_t  *cr,
+            gboolean  chamfer,
+            gdouble   xc,
+            gdouble   yc,
+            gdouble   radius,
+            gdouble   angle1,
+            gdouble   angle2)
+{
+  if (!chamfer)
+    {
+      cairo_arc (cr, xc, yc, radius, angle1, angle2);
+      return;
+    }
+
+  if (cairo_has_current_point (cr))
+    cairo_line_to (cr, xc + radius * cos (angle1), yc + radius * sin (angle1));
+  else
+    cairo_move_to (cr, xc + radius * cos (angle1), yc + radius * sin (angle1));
+
+  cairo_line_to (cr, xc + radius * cos (angle2), yc + radius * sin (angle2));
+}
+
+static void
+rectangle_sides (cairo_t          *cr,
+                 gboolean          chamfer,
+                 gdouble           radius,
+                 gdouble           x,
+                 gdouble           y,
+                 gdouble           width,
+                 gdouble           height,
+                 guint             sides,
+                 GtkJunctionSides  junction)
 {
   radius = CLAMP (radius, 0, MIN (width / 2, height / 2));
 
@@ -45,14 +187,14 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
       else
         {
           cairo_new_sub_path (cr);
-          cairo_arc (cr, x + width - radius, y + radius, radius, - G_PI / 4, 0);
+          corner_arc (cr, chamfer, x + width - radius, y + radius, radius, - G_PI / 4, 0);
         }
 
       if (radius == 0 ||
           (junction & GTK_JUNCTION_CORNER_BOTTOMRIGHT))
         cairo_line_to (cr, x + width, y + height);
       else
-        cairo_arc (cr, x + width - radius, y + height - radius, radius, 0, G_PI / 4);
+        corner_arc (cr, chamfer, x + width - radius, y + height - radius, radius, 0, G_PI / 4);
     }
 
   if (sides & SIDE_BOTTOM)
@@ -63,7 +205,7 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           if ((sides & SIDE_RIGHT) == 0)
             cairo_new_sub_path (cr);
 
-          cairo_arc (cr, x + width - radius, y + height - radius, radius, G_PI / 4, G_PI / 2);
+          corner_arc (cr, chamfer, x + width - radius, y + height - radius, radius, G_PI / 4, G_PI / 2);
         }
       else if ((sides & SIDE_RIGHT) == 0)
         cairo_move_to (cr, x + width, y + height);
@@ -72,7 +214,7 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           (junction & GTK_JUNCTION_CORNER_BOTTOMLEFT))
         cairo_line_to (cr, x, y + height);
       else
-        cairo_arc (cr, x + radius, y + height - radius, radius, G_PI / 2, 3 * (G_PI / 4));
+        corner_arc (cr, chamfer, x + radius, y + height - radius, radius, G_PI / 2, 3 * (G_PI / 4));
     }
   else
     cairo_move_to (cr, x, y + height);
@@ -85,7 +227,7 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           if ((sides & SIDE_BOTTOM) == 0)
             cairo_new_sub_path (cr);
 
-          cairo_arc (cr, x + radius, y + height - radius, radius, 3 * (G_PI / 4), G_PI);
+          corner_arc (cr, chamfer, x + radius, y + height - radius, radius, 3 * (G_PI / 4), G_PI);
         }
       else if ((sides & SIDE_BOTTOM) == 0)
         cairo_move_to (cr, x, y + height);
@@ -94,7 +236,7 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           (junction & GTK_JUNCTION_CORNER_TOPLEFT))
         cairo_line_to (cr, x, y);
       else
-        cairo_arc (cr, x + radius, y + radius, radius, G_PI, G_PI + G_PI / 4);
+        corner_arc (cr, chamfer, x + radius, y + radius, radius, G_PI, G_PI + G_PI / 4);
     }
 
   if (sides & SIDE_TOP)
@@ -105,7 +247,7 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           if ((sides & SIDE_LEFT) == 0)
             cairo_new_sub_path (cr);
 
-          cairo_arc (cr, x + radius, y + radius, radius, 5 * (G_PI / 4), 3 * (G_PI / 2));
+          corner_arc (cr, chamfer, x + radius, y + radius, radius, 5 * (G_PI / 4), 3 * (G_PI / 2));
         }
       else if ((sides & SIDE_LEFT) == 0)
         cairo_move_to (cr, x, y);
@@ -114,6 +256,993 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
           (junction & GTK_JUNCTION_CORNER_TOPRIGHT))
         cairo_line_to (cr, x + width, y);
       else
-        cairo_arc (cr, x + width - radius, y + radius, radius, 3 * (G_PI / 2), - G_PI / 4);
+        corner_arc (cr, chamfer, x + width - radius, y + radius, radius, 3 * (G_PI / 2), - G_PI / 4);
+    }
+}
+
+void
+_cairo_round_rectangle_sides (cairo_t          *cr,
+                              gdouble           radius,
+                              gdouble           x,
+                              gdouble           y,
+                              gdouble           width,
+                              gdouble           height,
+                              guint             sides,
+                              GtkJunctionSides  junction)
+{
+  rectangle_sides (cr, FALSE, radius, x, y, width, height, sides, junction);
+}
+
+void
+_cairo_chamfer_rectangle_sides (cairo_t          *cr,
+                                gdouble           radius,
+                                gdouble           x,
+                                gdouble           y,
+                                gdouble           width,
+                                gdouble           height,
+                                guint             sides,
+                                GtkJunctionSides  junction)
+{
+  rectangle_sides (cr, TRUE, radius, x, y, width, height, sides, junction);
+}
+
+/* Rendered surfaces are kept in a single cache shared by all
+ * engine instances and threads, holding at most a budget of bytes
+ * (ADWAITA_CACHE_BUDGET, in kilobytes) and dropping the least recently
+ * used entries when it's exceeded.
+ */
+#define CACHE_DEFAULT_BUDGET (4 * 1024 * 1024)
+
+typedef struct {
+  gchar *key;
+  cairo_surface_t *surface;
+  gsize size;
+  GList *link;
+} CacheEntry;
+
+G_LOCK_DEFINE_STATIC (cache);
+static GHashTable *cache_entries = NULL;
+/* most recently used first */
+static GQueue cache_lru = G_QUEUE_INIT;
+static gsize cache_size = 0;
+static gsize cache_budget = 0;
+static AdwaitaCacheStats cache_stats = { 0, };
+
+static GtkSettings *cache_settings = NULL;
+#if GLIB_CHECK_VERSION (2, 64, 0)
+static GMemoryMonitor *cache_memory_monitor = NULL;
+#endif
+
+static void
+cache_entry_free (gpointer data)
+{
+  CacheEntry *entry = data;
+
+  cairo_surface_destroy (entry->surface);
+
+  g_free (entry->key);
+  g_slice_free (CacheEntry, entry);
+}
+
+/* Called with the lock held */
+static gboolean
+cache_ensure (void)
+{
+  const gchar *budget;
+
+  if (cache_entries == NULL)
+    {
+      cache_entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             NULL, cache_entry_free);
+
+      budget = g_getenv ("ADWAITA_CACHE_BUDGET");
+      if (budget != NULL)
+        cache_budget = g_ascii_strtoull (budget, NULL, 10) * 1024;
+      else
+        cache_budget = CACHE_DEFAULT_BUDGET;
+    }
+
+  return cache_budget > 0;
+}
+
+/* Called with the lock held */
+static void
+cache_remove_entry (CacheEntry *entry)
+{
+  g_queue_delete_link (&cache_lru, entry->link);
+  cache_size -= entry->size;
+  g_hash_table_remove (cache_entries, entry->key);
+}
+
+/* Called with the lock held */
+static void
+cache_trim_to (gsize size)
+{
+  while (cache_size > size && cache_lru.tail != NULL)
+    {
+      cache_remove_entry (cache_lru.tail->data);
+      cache_stats.evictions++;
+    }
+}
+
+/* Called with the lock held; returns the entry for @key, marking it as
+ * the most recently used one.
+ */
+static CacheEntry *
+cache_lookup (const gchar *key)
+{
+  CacheEntry *entry;
+
+  if (!cache_ensure ())
+    return NULL;
+
+  entry = g_hash_table_lookup (cache_entries, key);
+
+  if (entry == NULL)
+    {
+      cache_stats.misses++;
+      return NULL;
+    }
+
+  cache_stats.hits++;
+  g_queue_unlink (&cache_lru, entry->link);
+  g_queue_push_head_link (&cache_lru, entry->link);
+
+  return entry;
+}
+
+static gsize
+cache_entry_size (const gchar *key,
+                  gsize        data_size)
+{
+  return data_size + sizeof (CacheEntry) + strlen (key) + 1;
+}
+
+/* Called with the lock held; takes ownership of @entry */
+static void
+cache_insert (CacheEntry *entry)
+{
+  CacheEntry *old;
+
+  entry->size = cache_entry_size (entry->key, entry->size);
+
+  /* it would evict everything else, and itself too */
+  if (!cache_ensure () || entry->size > cache_budget)
+    {
+      cache_entry_free (entry);
+      return;
+    }
+
+  old = g_hash_table_lookup (cache_entries, entry->key);
+  if (old != NULL)
+    cache_remove_entry (old);
+
+  cache_trim_to (cache_budget - entry->size);
+
+  g_queue_push_head (&cache_lru, entry);
+  entry->link = cache_lru.head;
+  cache_size += entry->size;
+  g_hash_table_insert (cache_entries, entry->key, entry);
+}
+
+/* Whether @data_size bytes cached for @key would fit in the budget, so
+ * that callers can avoid rendering what the cache would only drop.
+ */
+gboolean
+_adwaita_cache_fits (const gchar *key,
+                     gsize        data_size)
+{
+  gboolean retval;
+
+  G_LOCK (cache);
+  retval = cache_ensure () && cache_entry_size (key, data_size) <= cache_budget;
+  G_UNLOCK (cache);
+
+  return retval;
+}
+
+/* Returns a new reference to the surface cached for @key, or NULL */
+cairo_surface_t *
+_adwaita_cache_lookup_surface (const gchar *key)
+{
+  cairo_surface_t *surface = NULL;
+  CacheEntry *entry;
+
+  G_LOCK (cache);
+
+  entry = cache_lookup (key);
+  if (entry != NULL)
+    surface = cairo_surface_reference (entry->surface);
+
+  G_UNLOCK (cache);
+
+  return surface;
+}
+
+/* Caches @surface, which must be an image surface, for @key; the cache
+ * takes its own reference.
+ */
+void
+_adwaita_cache_insert_surface (const gchar     *key,
+                               cairo_surface_t *surface)
+{
+  CacheEntry *entry;
+
+  entry = g_slice_new0 (CacheEntry);
+  entry->key = g_strdup (key);
+  entry->surface = cairo_surface_reference (surface);
+  entry->size = cairo_image_surface_get_stride (surface) *
+    cairo_image_surface_get_height (surface);
+
+  G_LOCK (cache);
+  cache_insert (entry);
+  G_UNLOCK (cache);
+}
+
+/* Drops every entry, e.g. because the theme changed and they won't be
+ * used anymore; the statistics are kept.
+ */
+void
+_adwaita_cache_invalidate (void)
+{
+  G_LOCK (cache);
+
+  if (cache_entries != NULL)
+    {
+      g_queue_clear (&cache_lru);
+      g_hash_table_remove_all (cache_entries);
+      cache_size = 0;
+    }
+
+  G_UNLOCK (cache);
+}
+
+/* Evicts the least recently used entries until at most @fraction of
+ * the budget is used.
+ */
+void
+_adwaita_cache_trim (gdouble fraction)
+{
+  G_LOCK (cache);
+
+  if (cache_entries != NULL)
+    cache_trim_to (cache_budget * CLAMP (fraction, 0, 1));
+
+  G_UNLOCK (cache);
+}
+
+void
+_adwaita_cache_get_stats (AdwaitaCacheStats *stats)
+{
+  G_LOCK (cache);
+
+  cache_ensure ();
+  *stats = cache_stats;
+  stats->n_entries = g_queue_get_length (&cache_lru);
+  stats->size = cache_size;
+  stats->budget = cache_budget;
+
+  G_UNLOCK (cache);
+}
+
+static void
+settings_changed_cb (GObject    *settings,
+                     GParamSpec *pspec,
+                     gpointer    user_data)
+{
+  _adwaita_cache_invalidate ();
+}
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+static void
+low_memory_warning_cb (GMemoryMonitor             *monitor,
+                       GMemoryMonitorWarningLevel  level,
+                       gpointer                    user_data)
+{
+  if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+    _adwaita_cache_invalidate ();
+  else
+    _adwaita_cache_trim (0.5);
+}
+#endif
+
+/* Drops the cache contents when the theme or colour scheme changes in
+ * @settings, and trims it when the system runs low on memory. Only the
+ * first call does anything, so every engine instance can call it; the
+ * signals are delivered on the main thread.
+ */
+void
+_adwaita_cache_watch (GtkSettings *settings)
+{
+  G_LOCK (cache);
+
+  if (cache_settings != NULL || settings == NULL)
+    {
+      G_UNLOCK (cache);
+      return;
+    }
+
+  cache_settings = settings;
+  g_object_add_weak_pointer (G_OBJECT (settings), (gpointer *) &cache_settings);
+
+  G_UNLOCK (cache);
+
+  g_signal_connect (settings, "notify::gtk-theme-name",
+                    G_CALLBACK (settings_changed_cb), NULL);
+  g_signal_connect (settings, "notify::gtk-application-prefer-dark-theme",
+                    G_CALLBACK (settings_changed_cb), NULL);
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  cache_memory_monitor = g_memory_monitor_dup_default ();
+  g_signal_connect (cache_memory_monitor, "low-memory-warning",
+                    G_CALLBACK (low_memory_warning_cb), NULL);
+#endif
+}
+
+/* Frees the cache and stops watching for changes */
+void
+_adwaita_cache_free (void)
+{
+  if (cache_settings != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (cache_settings,
+                                            settings_changed_cb, NULL);
+      g_object_remove_weak_pointer (G_OBJECT (cache_settings),
+                                    (gpointer *) &cache_settings);
+      cache_settings = NULL;
+    }
+
+#if GLIB_CHECK_VERSION (2, 64, 0)
+  if (cache_memory_monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (cache_memory_monitor,
+                                            low_memory_warning_cb, NULL);
+      g_clear_object (&cache_memory_monitor);
+    }
+#endif
+
+  G_LOCK (cache);
+
+  if (cache_entries != NULL)
+    {
+      g_queue_clear (&cache_lru);
+      g_hash_table_destroy (cache_entries);
+      cache_entries = NULL;
+      cache_size = 0;
+    }
+
+  G_UNLOCK (cache);
+}
+
+/* The functions below only draw on the cairo context they're given,
+ * from values the caller already looked up in the style, and so can be
+ * called from several threads at once as long as each uses its own
+ * context. The few shared caches are protected by a lock.
+ */
+
+void
+_adwaita_draw_arrow (cairo_t              *cr,
+                     AdwaitaRenderQuality  quality,
+                     const GdkRGBA        *color,
+                     gdouble               angle,
+                     gdouble               x,
+                     gdouble               y,
+                     gdouble               size)
+{
+  double line_width;
+  gboolean fast;
+
+  fast = (quality == ADWAITA_RENDER_QUALITY_FAST);
+
+  if (fast)
+    {
+      x = floor (x + 0.5);
+      y = floor (y + 0.5);
+      size = floor (size + 0.5);
+    }
+
+  cairo_save (cr);
+
+  line_width = size / 3.0 / sqrt (2);
+  cairo_set_line_width (cr, line_width);
+
+  if (fast)
+    {
+      cairo_set_antialias (cr, CAIRO_ANTIALIAS_FAST);
+      cairo_set_line_join (cr, CAIRO_LINE_JOIN_MITER);
+      cairo_set_line_cap (cr, CAIRO_LINE_CAP_SQUARE);
+    }
+  else
+    {
+      cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+      cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+    }
+
+  cairo_translate (cr, x + size / 2.0, y + size / 2.0);
+  cairo_rotate (cr, angle - G_PI_2);
+  cairo_translate (cr, size / 4.0, 0);
+ 
+  cairo_scale (cr,
+               (size / (size + line_width)),
+               (size / (size + line_width)));
+
+  cairo_move_to (cr, -size / 2.0, -size / 2.0);
+  cairo_rel_line_to (cr, size / 2.0, size / 2.0);
+  cairo_rel_line_to (cr, - size / 2.0, size / 2.0);
+
+  gdk_cairo_set_source_rgba (cr, color);
+  cairo_stroke (cr);
+
+  cairo_restore (cr);
+}
+
+/* Strokes the focus ring with @color, or the current source of @cr
+ * if it's NULL.
+ */
+void
+_adwaita_draw_focus (cairo_t              *cr,
+                     AdwaitaRenderQuality  quality,
+                     const GdkRGBA        *color,
+                     gint                  border_radius,
+                     gboolean              use_dashes,
+                     gint                  line_width,
+                     gdouble               x,
+                     gdouble               y,
+                     gdouble               width,
+                     gdouble               height)
+{
+  double dashes[2] = { 2.0, 0.2 };
+
+  cairo_save (cr);
+  cairo_set_line_width (cr, line_width);
+
+  if (quality == ADWAITA_RENDER_QUALITY_FAST)
+    {
+      x = floor (x);
+      y = floor (y);
+      width = floor (width);
+      height = floor (height);
+
+      cairo_set_antialias (cr, CAIRO_ANTIALIAS_NONE);
+
+      if (line_width > 1)
+        _cairo_chamfer_rectangle_sides (cr, border_radius,
+                                        x, y, width, height,
+                                        SIDE_ALL, GTK_JUNCTION_NONE);
+      else
+        _cairo_chamfer_rectangle_sides (cr, border_radius,
+                                        x + 0.5, y + 0.5,
+                                        width - 1, height - 1,
+                                        SIDE_ALL, GTK_JUNCTION_NONE);
+    }
+  else if (line_width > 1)
+    _cairo_round_rectangle_sides (cr, border_radius,
+                                  x, y, width, height,
+                                  SIDE_ALL, GTK_JUNCTION_NONE);
+  else
+    _cairo_round_rectangle_sides (cr, border_radius,
+                                  x + 0.5, y + 0.5,
+                                  width - 1, height - 1,
+                                  SIDE_ALL, GTK_JUNCTION_NONE);
+
+  if (use_dashes)
+    cairo_set_dash (cr, dashes, 1, 0.0);
+
+  if (color != NULL)
+    gdk_cairo_set_source_rgba (cr, color);
+
+  cairo_stroke (cr);
+  cairo_restore (cr);
+}
+
+#define NOTEBOOK_TAB_TOP_MARGIN 3.0
+
+static void
+draw_tab_shape (cairo_t *cr,
+                gboolean chamfer,
+                gdouble curve_width,
+                gdouble x,
+                gdouble y,
+                gdouble width,
+                gdouble height)
+{
+  cairo_move_to (cr, x, height);
+
+  if (chamfer)
+    {
+      cairo_line_to (cr, x + curve_width - 2.5, y + 3.0);
+      cairo_line_to (cr, x + curve_width, y + 0.5);
+      cairo_line_to (cr, x + width - curve_width, y + 0.5);
+      cairo_line_to (cr, x + width - curve_width + 2.5, y + 3.0);
+    }
+  else
+    {
+      cairo_arc (cr, 
+                 x + curve_width, y + 3.0,
+                 2.5,
+                 G_PI, G_PI + G_PI_2);
+
+      cairo_arc (cr,
+                 x + width - curve_width, y + 3.0,
+                 2.5,
+                 G_PI + G_PI_2, 2 * G_PI);
+    }
+
+  cairo_line_to (cr, x + width, height);
+}
+
+/* Draws a notebook tab attached to a top or bottom gap. The background
+ * is left to @background_func, which is called with the tab shape as
+ * clip; the border is stroked with @border_gradient on active tabs if
+ * there's one, with @border_color otherwise.
+ */
+void
+_adwaita_draw_notebook_tab (cairo_t               *cr,
+                            AdwaitaRenderQuality   quality,
+                            gint                   tab_curvature,
+                            GtkPositionType        gap_side,
+                            gboolean               is_active,
+                            const GdkRGBA         *border_color,
+                            cairo_pattern_t       *border_gradient,
+                            AdwaitaBackgroundFunc  background_func,
+                            gpointer               user_data,
+                            gdouble                x,
+                            gdouble                y,
+                            gdouble                width,
+                            gdouble                height)
+{
+  gint border_width;
+  gdouble angle = 0;
+  gboolean fast;
+
+  fast = (quality == ADWAITA_RENDER_QUALITY_FAST);
+
+  if (fast)
+    {
+      x = floor (x);
+      y = floor (y);
+      width = floor (width);
+      height = floor (height);
+    }
+
+  border_width = 1.0;
+
+  cairo_save (cr);
+  cairo_set_line_width (cr, border_width);
+
+  if (fast)
+    cairo_set_antialias (cr, CAIRO_ANTIALIAS_NONE);
+
+  if (gap_side == GTK_POS_BOTTOM)
+    x += border_width / 2;
+  else if (gap_side == GTK_POS_TOP)
+    x -= border_width / 2;
+
+  if (gap_side == GTK_POS_TOP)
+    {
+      angle = G_PI;
+      cairo_translate (cr, x + width, y + height - NOTEBOOK_TAB_TOP_MARGIN - border_width);
+    }
+  else
+    {
+      cairo_translate (cr, x, y + NOTEBOOK_TAB_TOP_MARGIN + border_width);
+    }
+
+  cairo_rotate (cr, angle);
+
+  width -= border_width;
+  height -= NOTEBOOK_TAB_TOP_MARGIN + border_width;
+
+  /* draw the tab shape and clip the background inside it */
+  cairo_save (cr);
+  draw_tab_shape (cr, fast, tab_curvature,
+                  0, 0.5,
+                  width, is_active ? (height + 1.0) : (height));
+  cairo_clip (cr);
+
+  background_func (cr, 0, 0.5,
+                   width, is_active ? (height + 1.0) : (height),
+                   user_data);
+
+  cairo_restore (cr);
+
+  /* now draw the border */
+  draw_tab_shape (cr, fast, tab_curvature,
+                  0, 0,
+                  width, height);
+
+  if (border_gradient && is_active)
+    {
+      cairo_scale (cr, width, height);
+      cairo_set_source (cr, border_gradient);
+      cairo_scale (cr, 1.0 / width, 1.0 / height);
+    }
+  else
+    {
+      gdk_cairo_set_source_rgba (cr, border_color);
+    }
+
+  cairo_stroke (cr);
+  cairo_restore (cr);
+}
+
+/* Fits the box of an expander into the @width x @height area at @x, @y,
+ * centered on whole pixels and with an odd side length, which is
+ * returned. Tree views allocate 17 pixels for it, but get an 11 pixel
+ * box so that it doesn't touch the edge of the view.
+ */
+gdouble
+_adwaita_fit_expander (gboolean  is_tree_view,
+                       gdouble  *x,
+                       gdouble  *y,
+                       gdouble   width,
+                       gdouble   height)
+{
+  gdouble side;
+
+  side = floor (MIN (width, height));
+
+  if (is_tree_view && (side == 17))
+    {
+      *x += 3;
+      *y += 3;
+      width -= 6;
+      height -= 6;
+      side -= 6;
+    }
+
+  *x = floor (*x + width / 2 - side / 2);
+  *y = floor (*y + height / 2 - side / 2);
+
+  if (((gint) side % 2) == 0)
+    side -= 1.0;
+
+  return side;
+}
+
+/* Draws the minus sign of an expanded expander, or the plus sign of a
+ * collapsed one, inside the box of @side pixels at @x, @y.
+ */
+void
+_adwaita_draw_expander_sign (cairo_t         *cr,
+                             const GdkRGBA   *color,
+                             const GtkBorder *border,
+                             gboolean         expanded,
+                             gdouble          x,
+                             gdouble          y,
+                             gdouble          side)
+{
+  gdouble offset;
+  gint line_width;
+
+  line_width = 1;
+  offset = (1 + line_width / 2.0);
+
+  cairo_save (cr);
+
+  cairo_set_line_width (cr, line_width);
+  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+  gdk_cairo_set_source_rgba (cr, color);
+
+  cairo_move_to (cr,
+                 x + border->left + offset,
+                 y + side / 2);
+  cairo_line_to (cr,
+                 x + side - (border->right + offset),
+                 y + side / 2);
+
+  if (!expanded)
+    {
+      cairo_move_to (cr,
+                     x + side / 2,
+                     y + border->top + offset);
+      cairo_line_to (cr,
+                     x + side / 2,
+                     y + side - (border->bottom + offset));
+    }
+
+  cairo_stroke (cr);
+
+  cairo_restore (cr);
+}
+
+/* Returns the uniform user to device scale of @cr if it's only made of
+ * a translation to whole device pixels and a scale, 0 otherwise.
+ */
+gdouble
+_adwaita_get_pixel_aligned_scale (cairo_t *cr,
+                                  gdouble  x,
+                                  gdouble  y)
+{
+  cairo_matrix_t matrix;
+
+  cairo_get_matrix (cr, &matrix);
+
+  if (matrix.xy != 0 || matrix.yx != 0 ||
+      matrix.xx != matrix.yy || matrix.xx <= 0)
+    return 0;
+
+  cairo_user_to_device (cr, &x, &y);
+  if (x != floor (x) || y != floor (y))
+    return 0;
+
+  return matrix.xx;
+}
+
+/* Spinners are rendered once per (size, colour, scale) into a strip
+ * holding one frame for each of the SPINNER_NUM_STEPS steps of a full
+ * rotation; running spinners then just blit the frame matching the
+ * transition progress.
+ */
+static void
+draw_spinner_step (cairo_t       *cr,
+                   const GdkRGBA *color,
+                   gdouble        width,
+                   gdouble        height,
+                   guint          step)
+{
+  gdouble radius, half;
+  gint i;
+
+  radius = MIN (width / 2, height / 2);
+  half = SPINNER_NUM_STEPS / 2;
+
+  cairo_save (cr);
+  cairo_translate (cr, width / 2, height / 2);
+  cairo_set_line_width (cr, 2.0);
+
+  for (i = 0; i < SPINNER_NUM_STEPS; i++)
+    {
+      gint inset = 0.7 * radius;
+
+      /* transparency is a function of time and intial value */
+      gdouble t = 1.0 - (gdouble) ((i + step) % SPINNER_NUM_STEPS) / SPINNER_NUM_STEPS;
+      gdouble xscale = - sin (i * G_PI / half);
+      gdouble yscale = - cos (i * G_PI / half);
+
+      cairo_set_source_rgba (cr, color->red, color->green, color->blue, color->alpha * t);
+      cairo_move_to (cr, (radius - inset) * xscale, (radius - inset) * yscale);
+      cairo_line_to (cr, radius * xscale, radius * yscale);
+      cairo_stroke (cr);
+    }
+
+  cairo_restore (cr);
+}
+
+/* Largest width or height of a cairo image surface */
+#define MAX_IMAGE_SIZE 32767
+
+static gsize
+get_image_size (gint width,
+                gint height)
+{
+  return (gsize) cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width) * height;
+}
+
+/* Returns a new reference to the frames, which are cached by size,
+ * colour and scale, or NULL if they can't be cached.
+ */
+static cairo_surface_t *
+get_spinner_frames (const GdkRGBA *color,
+                    gint           width,
+                    gint           height,
+                    gdouble        scale)
+{
+  cairo_surface_t *frames;
+  cairo_t *cr;
+  gchar *key;
+  guint step;
+
+  key = g_strdup_printf ("spinner %d %d %g %g,%g,%g,%g",
+                         width, height, scale,
+                         color->red, color->green, color->blue, color->alpha);
+
+  frames = _adwaita_cache_lookup_surface (key);
+  if (frames != NULL)
+    {
+      g_free (key);
+      return frames;
     }
+
+  /* a strip too wide for an image surface, or too large for the cache,
+   * would render all the frames on every paint only to throw them away.
+   */
+  if (width * SPINNER_NUM_STEPS > MAX_IMAGE_SIZE || height > MAX_IMAGE_SIZE ||
+      !_adwaita_cache_fits (key, get_image_size (width * SPINNER_NUM_STEPS, height)))
+    {
+      g_free (key);
+      return NULL;
+    }
+
+  /* another thread may render the same frames in the meantime, in
+   * which case the last one to finish replaces the other's.
+   */
+  frames = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                       width * SPINNER_NUM_STEPS,
+                                       height);
+  cr = cairo_create (frames);
+
+  for (step = 0; step < SPINNER_NUM_STEPS; step++)
+    {
+      cairo_save (cr);
+      cairo_translate (cr, step * width, 0);
+      cairo_rectangle (cr, 0, 0, width, height);
+      cairo_clip (cr);
+      cairo_scale (cr, scale, scale);
+      draw_spinner_step (cr, color, width / scale, height / scale, step);
+      cairo_restore (cr);
+    }
+
+  cairo_destroy (cr);
+
+  _adwaita_cache_insert_surface (key, frames);
+  g_free (key);
+
+  return frames;
+}
+
+void
+_adwaita_draw_spinner (cairo_t       *cr,
+                       const GdkRGBA *color,
+                       guint          step,
+                       gboolean       use_cache,
+                       gdouble        x,
+                       gdouble        y,
+                       gdouble        width,
+                       gdouble        height)
+{
+  cairo_surface_t *frames = NULL;
+  gint frame_width, frame_height;
+  gdouble scale;
+
+  scale = _adwaita_get_pixel_aligned_scale (cr, x, y);
+  frame_width = ceil (width * scale);
+  frame_height = ceil (height * scale);
+
+  if (use_cache && scale != 0 && width > 0 && height > 0)
+    frames = get_spinner_frames (color, frame_width, frame_height, scale);
+
+  /* only the current step is needed when drawing directly */
+  if (frames == NULL)
+    {
+      cairo_save (cr);
+      cairo_translate (cr, x, y);
+      draw_spinner_step (cr, color, width, height, step);
+      cairo_restore (cr);
+      return;
+    }
+
+  cairo_save (cr);
+  cairo_translate (cr, x, y);
+  cairo_scale (cr, 1.0 / scale, 1.0 / scale);
+  cairo_rectangle (cr, 0, 0, frame_width, frame_height);
+  cairo_clip (cr);
+  cairo_set_source_surface (cr, frames, - (gdouble) step * frame_width, 0);
+  cairo_paint (cr);
+  cairo_restore (cr);
+
+  cairo_surface_destroy (frames);
+}
+
+/* Renders the frames of a @size spinner at @scale into the cache, as
+ * _adwaita_draw_spinner() would on its first paint.
+ */
+void
+_adwaita_cache_spinner_frames (const GdkRGBA *color,
+                               gdouble        size,
+                               gdouble        scale)
+{
+  cairo_surface_t *frames;
+
+  frames = get_spinner_frames (color, ceil (size * scale), ceil (size * scale), scale);
+
+  if (frames != NULL)
+    cairo_surface_destroy (frames);
+}
+
+/* Vertical gradients only vary along one axis, so they're rendered
+ * once per (stops, height, scale) into a 1 pixel wide strip, which is
+ * then stretched horizontally over the box.
+ */
+
+/* Returns a key identifying the gradient, or NULL if @pattern isn't a
+ * linear gradient along the vertical axis.
+ */
+static gchar *
+get_vertical_gradient_key (cairo_pattern_t *pattern,
+                           gint             height,
+                           gdouble          scale)
+{
+  gdouble x0, y0, x1, y1, offset, red, green, blue, alpha;
+  GString *key;
+  gint n_stops, i;
+
+  if (cairo_pattern_get_type (pattern) != CAIRO_PATTERN_TYPE_LINEAR ||
+      cairo_pattern_get_extend (pattern) != CAIRO_EXTEND_PAD)
+    return NULL;
+
+  cairo_pattern_get_linear_points (pattern, &x0, &y0, &x1, &y1);
+  if (x0 != x1 || y0 == y1)
+    return NULL;
+
+  key = g_string_new ("gradient ");
+  g_string_append_printf (key, "%d %g %g %g", height, scale, y0, y1);
+
+  cairo_pattern_get_color_stop_count (pattern, &n_stops);
+
+  for (i = 0; i < n_stops; i++)
+    {
+      cairo_pattern_get_color_stop_rgba (pattern, i, &offset,
+                                         &red, &green, &blue, &alpha);
+      g_string_append_printf (key, " %g:%g,%g,%g,%g",
+                              offset, red, green, blue, alpha);
+    }
+
+  return g_string_free (key, FALSE);
+}
+
+/* Returns a new reference to the strip for the background-image
+ * @pattern sized to @height user units at @scale, or NULL if @pattern
+ * isn't a vertical gradient.
+ */
+cairo_surface_t *
+_adwaita_get_gradient_strip (cairo_pattern_t *pattern,
+                             gdouble          height,
+                             gdouble          scale)
+{
+  cairo_surface_t *strip;
+  cairo_t *cr;
+  gint device_height;
+  gchar *key;
+
+  device_height = (gint) (height * scale);
+  if (device_height <= 0)
+    return NULL;
+
+  key = get_vertical_gradient_key (pattern, device_height, scale);
+  if (key == NULL)
+    return NULL;
+
+  strip = _adwaita_cache_lookup_surface (key);
+
+  if (strip == NULL)
+    {
+      strip = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, device_height);
+      cr = cairo_create (strip);
+      cairo_scale (cr, 1, device_height);
+      cairo_set_source (cr, pattern);
+      cairo_paint (cr);
+      cairo_destroy (cr);
+
+      _adwaita_cache_insert_surface (key, strip);
+    }
+
+  g_free (key);
+
+  return strip;
+}
+
+/* Fills the current clip of @cr with @strip, stretched horizontally
+ * and starting at @origin_y vertically.
+ */
+void
+_adwaita_paint_gradient_strip (cairo_t         *cr,
+                               cairo_surface_t *strip,
+                               gdouble          scale,
+                               gdouble          x,
+                               gdouble          origin_y)
+{
+  cairo_pattern_t *source;
+  cairo_matrix_t matrix;
+
+  source = cairo_pattern_create_for_surface (strip);
+  cairo_matrix_init_scale (&matrix, scale, scale);
+  cairo_matrix_translate (&matrix, - x, - origin_y);
+  cairo_pattern_set_matrix (source, &matrix);
+  cairo_pattern_set_extend (source, CAIRO_EXTEND_PAD);
+  cairo_pattern_set_filter (source, CAIRO_FILTER_NEAREST);
+  cairo_set_source (cr, source);
+  cairo_paint (cr);
+
+  cairo_pattern_destroy (source);
 }
@@ -36,6 +36,81 @@ enum {
   SIDE_ALL    = 0xF
 };
 
+typedef enum {
+  ADWAITA_RENDER_QUALITY_BEST,
+  ADWAITA_RENDER_QUALITY_FAST
+} AdwaitaRenderQuality;
+
+typedef enum {
+  ADWAITA_VFUNC_ARROW,
+  ADWAITA_VFUNC_FOCUS,
+  ADWAITA_VFUNC_EXTENSION,
+  ADWAITA_VFUNC_EXPANDER,
+  ADWAITA_VFUNC_ACTIVITY,
+  ADWAITA_VFUNC_BACKGROUND,
+  ADWAITA_N_VFUNCS
+} AdwaitaVFunc;
+
+typedef struct {
+  guint hits;
+  guint misses;
+  guint evictions;
+  guint n_entries;
+  gsize size;
+  gsize budget;
+} AdwaitaCacheStats;
+
+#define SPINNER_NUM_STEPS 12
+
+typedef void (* AdwaitaBackgroundFunc) (cairo_t *cr,
+                                        gdouble  x,
+                                        gdouble  y,
+                                        gdouble  width,
+                                        gdouble  height,
+                                        gpointer user_data);
+
+gboolean
+_adwaita_render_is_culled (AdwaitaVFunc      vfunc,
+                           cairo_t          *cr,
+                           gdouble           x,
+                           gdouble           y,
+                           gdouble           width,
+                           gdouble           height);
+
+gboolean
+_adwaita_render_stats_get (const gchar      *vfunc_name,
+                           guint            *culled,
+                           guint            *drawn);
+
+void
+_adwaita_render_stats_reset (void);
+
+gboolean
+_adwaita_cache_fits (const gchar     *key,
+                     gsize            data_size);
+
+cairo_surface_t *
+_adwaita_cache_lookup_surface (const gchar     *key);
+
+void
+_adwaita_cache_insert_surface (const gchar     *key,
+                               cairo_surface_t *surface);
+
+void
+_adwaita_cache_invalidate (void);
+
+void
+_adwaita_cache_trim (gdouble fraction);
+
+void
+_adwaita_cache_get_stats (AdwaitaCacheStats *stats);
+
+void
+_adwaita_cache_watch (GtkSettings *settings);
+
+void
+_adwaita_cache_free (void);
+
 void
 _cairo_round_rectangle_sides (cairo_t          *cr,
                               gdouble           radius,
@@ -46,4 +121,98 @@ _cairo_round_rectangle_sides (cairo_t          *cr,
                               guint             sides,
                               GtkJunctionSides  junction);
 
+void
+_cairo_chamfer_rectangle_sides (cairo_t          *cr,
+                                gdouble           radius,
+                                gdouble           x,
+                                gdouble           y,
+                                gdouble           width,
+                                gdouble           height,
+                                guint             sides,
+                                GtkJunctionSides  junction);
+
+void
+_adwaita_draw_arrow (cairo_t              *cr,
+                     AdwaitaRenderQuality  quality,
+                     const GdkRGBA        *color,
+                     gdouble               angle,
+                     gdouble               x,
+                     gdouble               y,
+                     gdouble               size);
+
+void
+_adwaita_draw_focus (cairo_t              *cr,
+                     AdwaitaRenderQuality  quality,
+                     const GdkRGBA        *color,
+                     gint                  border_radius,
+                     gboolean              use_dashes,
+                     gint                  line_width,
+                     gdouble               x,
+                     gdouble               y,
+                     gdouble               width,
+                     gdouble               height);
+
+void
+_adwaita_draw_notebook_tab (cairo_t               *cr,
+                            AdwaitaRenderQuality   quality,
+                            gint                   tab_curvature,
+                            GtkPositionType        gap_side,
+                            gboolean               is_active,
+                            const GdkRGBA         *border_color,
+                            cairo_pattern_t       *border_gradient,
+                            AdwaitaBackgroundFunc  background_func,
+                            gpointer               user_data,
+                            gdouble                x,
+                            gdouble                y,
+                            gdouble                width,
+                            gdouble                height);
+
+gdouble
+_adwaita_fit_expander (gboolean  is_tree_view,
+                       gdouble  *x,
+                       gdouble  *y,
+                       gdouble   width,
+                       gdouble   height);
+
+void
+_adwaita_draw_expander_sign (cairo_t         *cr,
+                             const GdkRGBA   *color,
+                             const GtkBorder *border,
+                             gboolean         expanded,
+                             gdouble          x,
+                             gdouble          y,
+                             gdouble          side);
+
+void
+_adwaita_draw_spinner (cairo_t       *cr,
+                       const GdkRGBA *color,
+                       guint          step,
+                       gboolean       use_cache,
+                       gdouble        x,
+                       gdouble        y,
+                       gdouble        width,
+                       gdouble        height);
+
+void
+_adwaita_cache_spinner_frames (const GdkRGBA *color,
+                               gdouble        size,
+                               gdouble        scale);
+
+gdouble
+_adwaita_get_pixel_aligned_scale (cairo_t *cr,
+                                  gdouble  x,
+                                  gdouble  y);
+
+cairo_surface_t *
+_adwaita_get_gradient_strip (cairo_pattern_t *pattern,
+                             gdouble          height,
+                             gdouble          scale);
+
+void
+_adwaita_paint_gradient_strip (cairo_t         *cr,
+                               cairo_surface_t *strip,
+                               gdouble          scale,
+                               gdouble          x,
+                               gdouble          origin_y);
+
 #endif /* __ADWAITA_UTILS_H__ */
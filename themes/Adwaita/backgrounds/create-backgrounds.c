@@ -0,0 +1,733 @@
+#include <gio/gio.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* Reads the timed background description and produces, for every
+ * requested screen size, a pre-scaled copy of each image plus
+ * pre-blended keyframes for every overlay transition. The emitted XML
+ * uses <size> alternatives everywhere, so the consumer only decodes
+ * images of the right size instead of full resolution ones. Each
+ * transition is replaced by a run of <static> slides showing its
+ * keyframes in turn, so the consumer never blends at runtime: it only
+ * decodes one image each time a keyframe is due.
+ */
+
+typedef struct {
+  gint width;
+  gint height;
+} BackgroundSize;
+
+typedef struct {
+  gboolean is_transition;
+  gdouble duration;
+  gchar *from;
+  gchar *to;
+} BackgroundSlide;
+
+typedef struct {
+  GString *starttime;
+  GList *slides;
+  BackgroundSlide *current;
+  gboolean in_starttime;
+} ParseData;
+
+static gchar *sizes_arg = NULL;
+static gint interval = 3600;
+static gint quality = 90;
+static gboolean benchmark = FALSE;
+static gint benchmark_iterations = 10;
+
+static GOptionEntry entries[] = {
+  { "sizes", 's', 0, G_OPTION_ARG_STRING, &sizes_arg,
+    "Comma separated list of screen sizes, e.g. 1366x768,1920x1080", "SIZES" },
+  { "interval", 'i', 0, G_OPTION_ARG_INT, &interval,
+    "Seconds between two pre-blended keyframes", "SECONDS" },
+  { "quality", 'q', 0, G_OPTION_ARG_INT, &quality,
+    "JPEG quality of the generated images", "QUALITY" },
+  { "benchmark", 'b', 0, G_OPTION_ARG_NONE, &benchmark,
+    "Time a runtime blend against loading a pre-blended keyframe", NULL },
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &benchmark_iterations,
+    "Number of benchmark iterations", "N" },
+  { NULL }
+};
+
+static void
+slide_free (BackgroundSlide *slide)
+{
+  g_free (slide->from);
+  g_free (slide->to);
+  g_slice_free (BackgroundSlide, slide);
+}
+
+static void
+parse_start_element (GMarkupParseContext  *context,
+                     const gchar          *element_name,
+                     const gchar         **attribute_names,
+                     const gchar         **attribute_values,
+                     gpointer              user_data,
+                     GError              **error)
+{
+  ParseData *data = user_data;
+
+  if (strcmp (element_name, "starttime") == 0)
+    {
+      data->in_starttime = TRUE;
+    }
+  else if (data->in_starttime)
+    {
+      g_string_append_printf (data->starttime, "    <%s>", element_name);
+    }
+  else if (strcmp (element_name, "static") == 0 ||
+           strcmp (element_name, "transition") == 0)
+    {
+      data->current = g_slice_new0 (BackgroundSlide);
+      data->current->is_transition = (element_name[0] == 't');
+    }
+}
+
+static void
+parse_end_element (GMarkupParseContext  *context,
+                   const gchar          *element_name,
+                   gpointer              user_data,
+                   GError              **error)
+{
+  ParseData *data = user_data;
+
+  if (strcmp (element_name, "starttime") == 0)
+    {
+      data->in_starttime = FALSE;
+    }
+  else if (data->in_starttime)
+    {
+      g_string_append_printf (data->starttime, "</%s>\n", element_name);
+    }
+  else if (data->current != NULL &&
+           (strcmp (element_name, "static") == 0 ||
+            strcmp (element_name, "transition") == 0))
+    {
+      data->slides = g_list_append (data->slides, data->current);
+      data->current = NULL;
+    }
+}
+
+static void
+parse_text (GMarkupParseContext  *context,
+            const gchar          *text,
+            gsize                 text_len,
+            gpointer              user_data,
+            GError              **error)
+{
+  ParseData *data = user_data;
+  const gchar *element;
+  gchar *str;
+
+  element = g_markup_parse_context_get_element (context);
+  str = g_strstrip (g_strndup (text, text_len));
+
+  if (data->in_starttime)
+    {
+      g_string_append (data->starttime, str);
+    }
+  else if (data->current != NULL)
+    {
+      if (strcmp (element, "duration") == 0)
+        data->current->duration = g_ascii_strtod (str, NULL);
+      else if (strcmp (element, "file") == 0 ||
+               strcmp (element, "from") == 0)
+        data->current->from = g_path_get_basename (str);
+      else if (strcmp (element, "to") == 0)
+        data->current->to = g_path_get_basename (str);
+    }
+
+  g_free (str);
+}
+
+static GArray *
+parse_sizes (const gchar *str)
+{
+  GArray *sizes;
+  gchar **tokens;
+  gint idx;
+
+  sizes = g_array_new (FALSE, FALSE, sizeof (BackgroundSize));
+  tokens = g_strsplit (str, ",", -1);
+
+  for (idx = 0; tokens[idx] != NULL; idx++)
+    {
+      BackgroundSize size;
+
+      if (sscanf (tokens[idx], "%dx%d", &size.width, &size.height) == 2 &&
+          size.width > 0 && size.height > 0)
+        g_array_append_val (sizes, size);
+      else
+        g_warning ("Ignoring invalid size '%s'", tokens[idx]);
+    }
+
+  g_strfreev (tokens);
+
+  return sizes;
+}
+
+static gchar *
+get_variant_name (const gchar *basename,
+                  const gchar *suffix,
+                  BackgroundSize *size)
+{
+  gchar *stem, *name;
+
+  stem = g_strndup (basename, strlen (basename) - strlen (".jpg"));
+  name = g_strdup_printf ("%s%s-%dx%d.jpg", stem, suffix ? suffix : "",
+                          size->width, size->height);
+  g_free (stem);
+
+  return name;
+}
+
+/* Scale to cover the whole screen and crop the center, which is what
+ * the "zoom" placement of the background would do at runtime.
+ */
+static GdkPixbuf *
+scale_to_cover (GdkPixbuf *source,
+                BackgroundSize *size)
+{
+  GdkPixbuf *dest;
+  gint src_width, src_height;
+  gdouble scale;
+
+  src_width = gdk_pixbuf_get_width (source);
+  src_height = gdk_pixbuf_get_height (source);
+  scale = MAX ((gdouble) size->width / src_width,
+               (gdouble) size->height / src_height);
+
+  dest = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                         size->width, size->height);
+  gdk_pixbuf_scale (source, dest,
+                    0, 0, size->width, size->height,
+                    (size->width - src_width * scale) / 2.0,
+                    (size->height - src_height * scale) / 2.0,
+                    scale, scale,
+                    GDK_INTERP_HYPER);
+
+  return dest;
+}
+
+/* gdk_pixbuf_composite() reads @to over the whole of @from, so @to is
+ * scaled to cover @from first when their sizes differ.
+ */
+static GdkPixbuf *
+blend (GdkPixbuf *from,
+       GdkPixbuf *to,
+       gdouble progress)
+{
+  BackgroundSize size;
+  GdkPixbuf *dest, *scaled = NULL;
+
+  size.width = gdk_pixbuf_get_width (from);
+  size.height = gdk_pixbuf_get_height (from);
+
+  if (gdk_pixbuf_get_width (to) != size.width ||
+      gdk_pixbuf_get_height (to) != size.height)
+    to = scaled = scale_to_cover (to, &size);
+
+  dest = gdk_pixbuf_copy (from);
+  gdk_pixbuf_composite (to, dest,
+                        0, 0,
+                        gdk_pixbuf_get_width (dest),
+                        gdk_pixbuf_get_height (dest),
+                        0, 0, 1.0, 1.0,
+                        GDK_INTERP_NEAREST,
+                        (gint) floor (progress * 255.0 + 0.5));
+
+  if (scaled != NULL)
+    g_object_unref (scaled);
+
+  return dest;
+}
+
+static GdkPixbuf *
+load_source (GHashTable *sources,
+             GFile *srcdir,
+             const gchar *basename)
+{
+  GdkPixbuf *pixbuf;
+  GFile *file;
+  gchar *path;
+  GError *error = NULL;
+
+  pixbuf = g_hash_table_lookup (sources, basename);
+  if (pixbuf != NULL)
+    return pixbuf;
+
+  file = g_file_get_child (srcdir, basename);
+  path = g_file_get_path (file);
+  pixbuf = gdk_pixbuf_new_from_file (path, &error);
+
+  if (pixbuf == NULL)
+    g_error ("Unable to load %s: %s", path, error->message);
+
+  g_hash_table_insert (sources, g_strdup (basename), pixbuf);
+  g_object_unref (file);
+  g_free (path);
+
+  return pixbuf;
+}
+
+static void
+save_variant (GdkPixbuf *pixbuf,
+              GFile *destdir,
+              const gchar *name,
+              GString *manifest)
+{
+  GFile *file;
+  gchar *path, *quality_str;
+  GError *error = NULL;
+
+  file = g_file_get_child (destdir, name);
+  path = g_file_get_path (file);
+  quality_str = g_strdup_printf ("%d", CLAMP (quality, 1, 100));
+
+  if (!gdk_pixbuf_save (pixbuf, path, "jpeg", &error,
+                        "quality", quality_str, NULL))
+    g_error ("Unable to write %s: %s", path, error->message);
+
+  g_string_append_printf (manifest, "%s\n", name);
+
+  g_object_unref (file);
+  g_free (path);
+  g_free (quality_str);
+}
+
+/* Appends <@element> with the variant of @basename for every size */
+static void
+append_file (GString *xml,
+             const gchar *element,
+             const gchar *basename,
+             const gchar *suffix,
+             GArray *sizes)
+{
+  gint idx;
+
+  g_string_append_printf (xml, "<%s>\n", element);
+
+  for (idx = 0; idx < sizes->len; idx++)
+    {
+      BackgroundSize *size = &g_array_index (sizes, BackgroundSize, idx);
+      gchar *name = get_variant_name (basename, suffix, size);
+
+      g_string_append_printf (xml,
+                              "  <size width=\"%d\" height=\"%d\">"
+                              "@datadir@/themes/Adwaita/backgrounds/%s</size>\n",
+                              size->width, size->height, name);
+      g_free (name);
+    }
+
+  g_string_append_printf (xml, "</%s>\n", element);
+}
+
+static void
+append_static (GString *xml,
+               gdouble duration,
+               const gchar *basename,
+               GArray *sizes)
+{
+  g_string_append_printf (xml, "<static>\n<duration>%.1f</duration>\n", duration);
+  append_file (xml, "file", basename, NULL, sizes);
+  g_string_append (xml, "</static>\n");
+}
+
+static gchar *
+get_keyframe_suffix (BackgroundSlide *slide,
+                     gint keyframe)
+{
+  gchar *to_stem, *suffix;
+
+  to_stem = g_strndup (slide->to, strlen (slide->to) - strlen (".jpg"));
+  suffix = g_strdup_printf ("-%s-%02d", to_stem, keyframe);
+  g_free (to_stem);
+
+  return suffix;
+}
+
+static gint
+get_n_keyframes (BackgroundSlide *slide)
+{
+  return MAX (1, (gint) ceil (slide->duration / interval));
+}
+
+/* Keyframe @keyframe of @slide shown on its own, 0 being the first
+ * image of the transition
+ */
+static void
+append_keyframe (GString *xml,
+                 gdouble duration,
+                 BackgroundSlide *slide,
+                 gint keyframe,
+                 GArray *sizes)
+{
+  gchar *suffix;
+
+  suffix = keyframe > 0 ? get_keyframe_suffix (slide, keyframe) : NULL;
+
+  g_string_append_printf (xml, "<static>\n<duration>%.1f</duration>\n", duration);
+  append_file (xml, "file", slide->from, suffix, sizes);
+  g_string_append (xml, "</static>\n");
+
+  g_free (suffix);
+}
+
+static void
+write_backgrounds (GList *slides,
+                   GArray *sizes,
+                   GFile *srcdir,
+                   GFile *destdir,
+                   GString *xml,
+                   GString *manifest)
+{
+  GHashTable *sources, *written;
+  GList *l;
+  gint idx, keyframe, n_keyframes;
+
+  sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  written = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (idx = 0; idx < sizes->len; idx++)
+    {
+      BackgroundSize *size = &g_array_index (sizes, BackgroundSize, idx);
+
+      g_print ("Writing size: %dx%d\n", size->width, size->height);
+
+      for (l = slides; l != NULL; l = l->next)
+        {
+          BackgroundSlide *slide = l->data;
+          GdkPixbuf *from, *to, *keyframe_pixbuf;
+          gchar *name, *suffix;
+
+          from = scale_to_cover (load_source (sources, srcdir, slide->from), size);
+          name = get_variant_name (slide->from, NULL, size);
+
+          if (!g_hash_table_contains (written, name))
+            {
+              save_variant (from, destdir, name, manifest);
+              g_hash_table_add (written, name);
+            }
+          else
+            g_free (name);
+
+          if (!slide->is_transition)
+            {
+              g_object_unref (from);
+              continue;
+            }
+
+          to = scale_to_cover (load_source (sources, srcdir, slide->to), size);
+          n_keyframes = get_n_keyframes (slide);
+
+          /* the slide after the transition shows it */
+          name = get_variant_name (slide->to, NULL, size);
+
+          if (!g_hash_table_contains (written, name))
+            {
+              save_variant (to, destdir, name, manifest);
+              g_hash_table_add (written, name);
+            }
+          else
+            g_free (name);
+
+          for (keyframe = 1; keyframe < n_keyframes; keyframe++)
+            {
+              keyframe_pixbuf = blend (from, to, (gdouble) keyframe / n_keyframes);
+              suffix = get_keyframe_suffix (slide, keyframe);
+              name = get_variant_name (slide->from, suffix, size);
+
+              save_variant (keyframe_pixbuf, destdir, name, manifest);
+
+              g_object_unref (keyframe_pixbuf);
+              g_free (suffix);
+              g_free (name);
+            }
+
+          g_object_unref (from);
+          g_object_unref (to);
+        }
+    }
+
+  /* the timed XML: every transition becomes a run of static slides,
+   * one per keyframe, the next slide being the last image
+   */
+  for (l = slides; l != NULL; l = l->next)
+    {
+      BackgroundSlide *slide = l->data;
+
+      if (!slide->is_transition)
+        {
+          append_static (xml, slide->duration, slide->from, sizes);
+          continue;
+        }
+
+      n_keyframes = get_n_keyframes (slide);
+
+      for (keyframe = 0; keyframe < n_keyframes; keyframe++)
+        append_keyframe (xml, slide->duration / n_keyframes,
+                         slide, keyframe, sizes);
+    }
+
+  g_hash_table_destroy (sources);
+  g_hash_table_destroy (written);
+}
+
+static gchar *
+get_path (GFile *dir,
+          const gchar *name)
+{
+  GFile *file;
+  gchar *path;
+
+  file = g_file_get_child (dir, name);
+  path = g_file_get_path (file);
+  g_object_unref (file);
+
+  return path;
+}
+
+static GdkPixbuf *
+load_file (const gchar *path)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = gdk_pixbuf_new_from_file (path, NULL);
+  if (pixbuf == NULL)
+    g_error ("Unable to load %s", path);
+
+  return pixbuf;
+}
+
+/* Compares what the consumer does on an update of a transition with
+ * each XML. The original one makes it decode both full size images,
+ * scale them to the screen and blend them, or only blend them when it
+ * still has the scaled images around. The generated one only has
+ * static slides, so the consumer decodes one pre-scaled keyframe when
+ * it's due and has nothing to do in between.
+ */
+static void
+run_benchmark (GList *slides,
+               GArray *sizes,
+               GFile *srcdir,
+               GFile *destdir)
+{
+  BackgroundSlide *slide = NULL;
+  BackgroundSize *size;
+  GdkPixbuf *from, *to, *scaled_from, *scaled_to, *blended;
+  GTimer *timer;
+  GList *l;
+  gchar *from_path, *to_path, *keyframe_path, *name, *suffix;
+  gdouble cold_elapsed, warm_elapsed, prerendered_elapsed;
+  gint idx;
+
+  for (l = slides; l != NULL; l = l->next)
+    if (((BackgroundSlide *) l->data)->is_transition)
+      {
+        slide = l->data;
+        break;
+      }
+
+  if (slide == NULL || get_n_keyframes (slide) < 2)
+    {
+      g_printerr ("No transition with keyframes to benchmark\n");
+      return;
+    }
+
+  size = &g_array_index (sizes, BackgroundSize, 0);
+
+  from_path = get_path (srcdir, slide->from);
+  to_path = get_path (srcdir, slide->to);
+
+  suffix = get_keyframe_suffix (slide, 1);
+  name = get_variant_name (slide->from, suffix, size);
+  keyframe_path = get_path (destdir, name);
+
+  timer = g_timer_new ();
+
+  for (idx = 0; idx < benchmark_iterations; idx++)
+    {
+      from = load_file (from_path);
+      to = load_file (to_path);
+      scaled_from = scale_to_cover (from, size);
+      scaled_to = scale_to_cover (to, size);
+      blended = blend (scaled_from, scaled_to, 0.5);
+      g_object_unref (from);
+      g_object_unref (to);
+      g_object_unref (scaled_from);
+      g_object_unref (scaled_to);
+      g_object_unref (blended);
+    }
+
+  cold_elapsed = g_timer_elapsed (timer, NULL);
+
+  from = load_file (from_path);
+  to = load_file (to_path);
+  scaled_from = scale_to_cover (from, size);
+  scaled_to = scale_to_cover (to, size);
+  g_object_unref (from);
+  g_object_unref (to);
+
+  g_timer_start (timer);
+
+  for (idx = 0; idx < benchmark_iterations; idx++)
+    {
+      blended = blend (scaled_from, scaled_to, (gdouble) idx / benchmark_iterations);
+      g_object_unref (blended);
+    }
+
+  warm_elapsed = g_timer_elapsed (timer, NULL);
+  g_object_unref (scaled_from);
+  g_object_unref (scaled_to);
+
+  g_timer_start (timer);
+
+  for (idx = 0; idx < benchmark_iterations; idx++)
+    {
+      blended = load_file (keyframe_path);
+      g_object_unref (blended);
+    }
+
+  prerendered_elapsed = g_timer_elapsed (timer, NULL);
+
+  g_print ("Screen size: %dx%d, %d iterations\n",
+           size->width, size->height, benchmark_iterations);
+  g_print ("  original XML, each update:\n");
+  g_print ("    decode, scale and blend:   %8.2f ms\n",
+           1000.0 * cold_elapsed / benchmark_iterations);
+  g_print ("    blend of scaled images:    %8.2f ms\n",
+           1000.0 * warm_elapsed / benchmark_iterations);
+  g_print ("  generated XML, each keyframe (%d per transition, none in between):\n",
+           get_n_keyframes (slide));
+  g_print ("    decode pre-scaled image:   %8.2f ms\n",
+           1000.0 * prerendered_elapsed / benchmark_iterations);
+
+  g_timer_destroy (timer);
+  g_free (from_path);
+  g_free (to_path);
+  g_free (keyframe_path);
+  g_free (name);
+  g_free (suffix);
+}
+
+static gboolean
+process (const gchar *xml_path,
+         const gchar *dest_path)
+{
+  static const GMarkupParser parser = {
+    parse_start_element,
+    parse_end_element,
+    parse_text,
+    NULL,
+    NULL
+  };
+  GMarkupParseContext *context;
+  ParseData data = { NULL, };
+  GArray *sizes;
+  GFile *xml_file, *srcdir, *destdir;
+  GString *xml, *manifest;
+  gchar *contents, *str;
+  gsize length;
+  GError *error = NULL;
+
+  if (!g_file_get_contents (xml_path, &contents, &length, &error))
+    {
+      g_critical ("Unable to read %s: %s", xml_path, error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  data.starttime = g_string_new (NULL);
+  context = g_markup_parse_context_new (&parser, 0, &data, NULL);
+
+  if (!g_markup_parse_context_parse (context, contents, length, &error) ||
+      !g_markup_parse_context_end_parse (context, &error))
+    {
+      g_critical ("Unable to parse %s: %s", xml_path, error->message);
+      g_error_free (error);
+      g_markup_parse_context_free (context);
+      g_free (contents);
+      return FALSE;
+    }
+
+  g_markup_parse_context_free (context);
+  g_free (contents);
+
+  xml_file = g_file_new_for_commandline_arg (xml_path);
+  srcdir = g_file_get_parent (xml_file);
+  destdir = g_file_new_for_commandline_arg (dest_path);
+  g_file_make_directory_with_parents (destdir, NULL, NULL);
+
+  sizes = parse_sizes (sizes_arg ? sizes_arg : "1920x1200");
+  interval = MAX (interval, 60);
+
+  if (benchmark)
+    {
+      run_benchmark (data.slides, sizes, srcdir, destdir);
+    }
+  else
+    {
+      xml = g_string_new ("<background>\n  <starttime>\n");
+      g_string_append (xml, data.starttime->str);
+      g_string_append (xml, "  </starttime>\n\n"
+                       "<!-- Generated by create-backgrounds, do not edit. -->\n\n");
+      manifest = g_string_new (NULL);
+
+      write_backgrounds (data.slides, sizes, srcdir, destdir, xml, manifest);
+      g_string_append (xml, "</background>\n");
+
+      str = g_build_filename (dest_path, "adwaita-timed-prerendered.xml.in", NULL);
+      g_file_set_contents (str, xml->str, -1, NULL);
+      g_free (str);
+
+      str = g_build_filename (dest_path, "prerendered.list", NULL);
+      g_file_set_contents (str, manifest->str, -1, NULL);
+      g_free (str);
+
+      g_string_free (xml, TRUE);
+      g_string_free (manifest, TRUE);
+    }
+
+  g_list_free_full (data.slides, (GDestroyNotify) slide_free);
+  g_string_free (data.starttime, TRUE);
+  g_array_unref (sizes);
+  g_object_unref (xml_file);
+  g_object_unref (srcdir);
+  g_object_unref (destdir);
+
+  return TRUE;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("TIMED-XML DEST-DIR - pre-render the timed background");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_critical ("%s", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (argc != 3)
+    {
+      g_critical ("The timed background XML and the destination directory must be given");
+      return 1;
+    }
+
+  g_type_init ();
+
+  return process (argv[1], argv[2]) ? 0 : 1;
+}
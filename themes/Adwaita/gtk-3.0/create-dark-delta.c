@@ -0,0 +1,1479 @@
+/* Adwaita - create-dark-delta
+ *
+ * Copyright (C) 2026 The GNOME Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Computes the difference between the light and dark stylesheets, once
+ * all their imports are flattened, and writes it as a sheet that turns
+ * the already loaded light theme into the dark one when added on top of
+ * it with a higher priority.
+ *
+ * GTK+ lets a higher priority provider win regardless of selector
+ * specificity, so a dark declaration in the delta also beats the light
+ * declarations that outrank it, and those may have to be carried over
+ * as well. Rather than carrying every declaration that might, the style
+ * of every element the two stylesheets name is resolved, and dark
+ * declarations are added until the light sheet plus the delta resolves
+ * like the dark sheet for all of them. Where the dark sheet drops a
+ * light declaration, it is overridden on its own selector with the
+ * value the dark sheet gives instead.
+ */
+
+typedef struct {
+  gchar *type;
+  gchar **classes;
+  gchar **pseudo_classes;
+  gchar **ids;
+} Compound;
+
+typedef struct {
+  gchar *text;
+  gchar *key;
+  Compound *compounds;
+  gboolean *child;
+  gint n_compounds;
+  gint specificity;
+} Selector;
+
+typedef struct _Declaration Declaration;
+
+typedef struct {
+  Selector **selectors;
+  gint n_selectors;
+  GPtrArray *properties;
+  GPtrArray *values;
+  Declaration **declarations;
+} Rule;
+
+/* One property of a rule for one of its selectors. Declarations that
+ * only exist in the delta have no rule, and a NULL value resets the
+ * property to its initial value.
+ */
+struct _Declaration {
+  Rule *rule;
+  Selector *selector;
+  gint position;
+  gint index;
+  const gchar *property;
+  const gchar *value;
+  gboolean keep;
+};
+
+typedef struct {
+  GPtrArray *rules;
+  GPtrArray *declarations;
+  GPtrArray *color_names;
+  GHashTable *colors;
+  GPtrArray *at_rules;
+  gsize size;
+} StyleSheet;
+
+typedef struct {
+  Selector *selector;
+  GHashTable *light;
+  GHashTable *dark;
+} Element;
+
+static gchar **source_dirs = NULL;
+
+static GOptionEntry entries[] = {
+  { "sourcedir", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &source_dirs,
+    "Directory to look for the stylesheets in (can be repeated)", "DIR" },
+  { NULL }
+};
+
+/* Subtypes named in the stylesheets, which type selectors match too */
+static const gchar *parent_types[][2] = {
+  { "GtkToggleButton", "GtkButton" },
+  { "GtkCheckButton", "GtkToggleButton" },
+  { "GtkRadioButton", "GtkCheckButton" },
+  { "GtkLinkButton", "GtkButton" },
+  { "GtkColorButton", "GtkButton" },
+  { "GtkScale", "GtkRange" },
+  { "GtkScrollbar", "GtkRange" },
+  { "GtkSpinButton", "GtkEntry" },
+  { "GtkCheckMenuItem", "GtkMenuItem" },
+  { "GtkMenuBar", "GtkMenuShell" },
+  { "GtkMenu", "GtkMenuShell" }
+};
+
+static const gchar *sides[] = { "top", "right", "bottom", "left" };
+static const gchar *corners[] = { "top-left", "top-right", "bottom-right", "bottom-left" };
+
+/* the classes used with each type, for elements only styled by class */
+static GHashTable *type_classes = NULL;
+static GHashTable *longhands = NULL;
+
+static gchar *
+collapse_whitespace (const gchar *str,
+                     gsize        len)
+{
+  GString *result;
+  gboolean space = FALSE;
+  gsize i;
+
+  result = g_string_sized_new (len);
+
+  for (i = 0; i < len; i++)
+    {
+      if (g_ascii_isspace (str[i]))
+        {
+          space = TRUE;
+          continue;
+        }
+
+      if (space && result->len > 0)
+        g_string_append_c (result, ' ');
+
+      g_string_append_c (result, str[i]);
+      space = FALSE;
+    }
+
+  return g_string_free (result, FALSE);
+}
+
+static void
+strip_comments (gchar *contents)
+{
+  gchar *start, *end;
+
+  while ((start = strstr (contents, "/*")) != NULL)
+    {
+      end = strstr (start + 2, "*/");
+
+      if (end == NULL)
+        {
+          *start = '\0';
+          break;
+        }
+
+      memmove (start, end + 2, strlen (end + 2) + 1);
+      contents = start;
+    }
+}
+
+/* Returns the length of the text up to the first @separator that isn't
+ * nested in parentheses or quotes.
+ */
+static gsize
+scan_to (const gchar *str,
+         gsize        len,
+         gchar        separator)
+{
+  gint depth = 0;
+  gchar quote = 0;
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    {
+      if (quote != 0)
+        {
+          if (str[i] == quote)
+            quote = 0;
+        }
+      else if (str[i] == '"' || str[i] == '\'')
+        quote = str[i];
+      else if (str[i] == '(')
+        depth++;
+      else if (str[i] == ')')
+        depth--;
+      else if (str[i] == separator && depth == 0)
+        break;
+    }
+
+  return i;
+}
+
+/* Returns the position after the parenthesized arguments at @i */
+static gsize
+skip_arguments (const gchar *str,
+                gsize        len,
+                gsize        i)
+{
+  while (i < len && str[i] != ')')
+    i++;
+
+  return MIN (i + 1, len);
+}
+
+static const gchar *
+get_parent_type (const gchar *type)
+{
+  gint i;
+
+  for (i = 0; i < G_N_ELEMENTS (parent_types); i++)
+    if (strcmp (parent_types[i][0], type) == 0)
+      return parent_types[i][1];
+
+  return NULL;
+}
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+static gchar **
+sorted_strv (GPtrArray *array)
+{
+  g_ptr_array_sort (array, compare_strings);
+  g_ptr_array_add (array, NULL);
+
+  return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+static gboolean
+strv_contains_all (gchar **haystack,
+                   gchar **needles)
+{
+  gint i, j;
+
+  for (i = 0; needles[i] != NULL; i++)
+    {
+      for (j = 0; haystack[j] != NULL; j++)
+        if (strcmp (haystack[j], needles[i]) == 0)
+          break;
+
+      if (haystack[j] == NULL)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Parses a compound selector such as "GtkSwitch.trough:backdrop", with
+ * the classes and pseudo-classes sorted and the old pseudo-class names
+ * replaced, so that equivalent compounds compare equal.
+ */
+static void
+parse_compound (Compound    *compound,
+                const gchar *str,
+                gsize        len,
+                gint        *specificity)
+{
+  GPtrArray *classes, *pseudo_classes, *ids;
+  gchar *name;
+  gchar kind;
+  gsize i, start;
+
+  classes = g_ptr_array_new ();
+  pseudo_classes = g_ptr_array_new ();
+  ids = g_ptr_array_new ();
+  compound->type = NULL;
+
+  for (i = 0; i < len;)
+    {
+      kind = str[i];
+
+      if (kind == '.' || kind == ':' || kind == '#')
+        i++;
+      else
+        kind = 0;
+
+      start = i;
+
+      if (str[i] == '*')
+        i++;
+
+      while (i < len && (g_ascii_isalnum (str[i]) || str[i] == '-' || str[i] == '_'))
+        i++;
+
+      /* e.g. :nth-child(even) */
+      if (i < len && str[i] == '(')
+        i = skip_arguments (str, len, i);
+
+      name = g_strndup (str + start, i - start);
+
+      if (kind == '.')
+        g_ptr_array_add (classes, name);
+      else if (kind == '#')
+        g_ptr_array_add (ids, name);
+      else if (kind == ':')
+        {
+          if (strcmp (name, "prelight") == 0)
+            {
+              g_free (name);
+              name = g_strdup ("hover");
+            }
+          else if (strcmp (name, "focused") == 0)
+            {
+              g_free (name);
+              name = g_strdup ("focus");
+            }
+
+          g_ptr_array_add (pseudo_classes, name);
+        }
+      else if (strcmp (name, "*") != 0 && name[0] != '\0')
+        compound->type = name;
+      else
+        g_free (name);
+
+      if (i == start)
+        i++;
+    }
+
+  *specificity += 10000 * ids->len + 100 * (classes->len + pseudo_classes->len) +
+                  (compound->type != NULL ? 1 : 0);
+
+  compound->classes = sorted_strv (classes);
+  compound->pseudo_classes = sorted_strv (pseudo_classes);
+  compound->ids = sorted_strv (ids);
+}
+
+static void
+append_compound (GString  *str,
+                 Compound *compound)
+{
+  gint i;
+
+  if (compound->type != NULL)
+    g_string_append (str, compound->type);
+  else if (compound->classes[0] == NULL &&
+           compound->pseudo_classes[0] == NULL &&
+           compound->ids[0] == NULL)
+    g_string_append_c (str, '*');
+
+  for (i = 0; compound->ids[i] != NULL; i++)
+    g_string_append_printf (str, "#%s", compound->ids[i]);
+
+  for (i = 0; compound->classes[i] != NULL; i++)
+    g_string_append_printf (str, ".%s", compound->classes[i]);
+
+  for (i = 0; compound->pseudo_classes[i] != NULL; i++)
+    g_string_append_printf (str, ":%s", compound->pseudo_classes[i]);
+}
+
+static Selector *
+parse_selector (gchar *text)
+{
+  GArray *compounds, *child;
+  Selector *selector;
+  Compound compound;
+  GString *key;
+  gboolean is_child = FALSE;
+  gsize len, i, n;
+  gint c;
+
+  selector = g_slice_new0 (Selector);
+  selector->text = text;
+
+  compounds = g_array_new (FALSE, FALSE, sizeof (Compound));
+  child = g_array_new (FALSE, FALSE, sizeof (gboolean));
+  len = strlen (text);
+
+  for (i = 0; i < len;)
+    {
+      if (text[i] == ' ')
+        {
+          i++;
+          continue;
+        }
+
+      /* siblings aren't told apart from ancestors */
+      if (text[i] == '>' || text[i] == '+' || text[i] == '~')
+        {
+          is_child = (text[i] == '>');
+          i++;
+          continue;
+        }
+
+      for (n = i; n < len && text[n] != ' ' && text[n] != '>' &&
+                  text[n] != '+' && text[n] != '~';)
+        {
+          if (text[n] == '(')
+            n = skip_arguments (text, len, n);
+          else
+            n++;
+        }
+
+      parse_compound (&compound, text + i, n - i, &selector->specificity);
+      g_array_append_val (compounds, compound);
+      g_array_append_val (child, is_child);
+
+      is_child = FALSE;
+      i = n;
+    }
+
+  selector->n_compounds = compounds->len;
+  selector->compounds = (Compound *) g_array_free (compounds, FALSE);
+  selector->child = (gboolean *) g_array_free (child, FALSE);
+
+  key = g_string_new (NULL);
+
+  for (c = 0; c < selector->n_compounds; c++)
+    {
+      if (c > 0)
+        g_string_append (key, selector->child[c] ? " > " : " ");
+
+      append_compound (key, &selector->compounds[c]);
+    }
+
+  selector->key = g_string_free (key, FALSE);
+
+  return selector;
+}
+
+static void
+add_type_classes (Selector *selector)
+{
+  GHashTable *classes;
+  Compound *compound;
+  const gchar *type;
+  gint c, i;
+
+  for (c = 0; c < selector->n_compounds; c++)
+    {
+      compound = &selector->compounds[c];
+
+      for (type = compound->type; type != NULL; type = get_parent_type (type))
+        {
+          classes = g_hash_table_lookup (type_classes, type);
+
+          if (classes == NULL)
+            {
+              classes = g_hash_table_new (g_str_hash, g_str_equal);
+              g_hash_table_insert (type_classes, (gpointer) type, classes);
+            }
+
+          for (i = 0; compound->classes[i] != NULL; i++)
+            g_hash_table_add (classes, compound->classes[i]);
+        }
+    }
+}
+
+static gboolean
+type_matches (const gchar *type,
+              Compound    *node)
+{
+  GHashTable *classes;
+  const gchar *node_type;
+  gint i;
+
+  if (type == NULL || strcmp (type, "GtkWidget") == 0)
+    return TRUE;
+
+  /* an element the stylesheets only style by class may be of any type
+   * that is used with one of its classes
+   */
+  if (node->type == NULL)
+    {
+      if (node->classes[0] == NULL)
+        return TRUE;
+
+      classes = g_hash_table_lookup (type_classes, type);
+
+      for (i = 0; classes != NULL && node->classes[i] != NULL; i++)
+        if (g_hash_table_contains (classes, node->classes[i]))
+          return TRUE;
+
+      return FALSE;
+    }
+
+  for (node_type = node->type; node_type != NULL; node_type = get_parent_type (node_type))
+    if (strcmp (node_type, type) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static gboolean
+compound_matches (Compound *compound,
+                  Compound *node)
+{
+  return type_matches (compound->type, node) &&
+         strv_contains_all (node->classes, compound->classes) &&
+         strv_contains_all (node->pseudo_classes, compound->pseudo_classes) &&
+         strv_contains_all (node->ids, compound->ids);
+}
+
+static gboolean
+match_from (Selector *selector,
+            gint      c,
+            Compound *path,
+            gint      p)
+{
+  gint q;
+
+  if (!compound_matches (&selector->compounds[c], &path[p]))
+    return FALSE;
+
+  if (c == 0)
+    return TRUE;
+
+  if (selector->child[c])
+    return p > 0 && match_from (selector, c - 1, path, p - 1);
+
+  for (q = p - 1; q >= 0; q--)
+    if (match_from (selector, c - 1, path, q))
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Whether @selector matches the element that @element names, taking
+ * its compounds as the path from an ancestor down to the element.
+ */
+static gboolean
+selector_matches (Selector *selector,
+                  Selector *element)
+{
+  if (selector->n_compounds == 0 || element->n_compounds == 0)
+    return FALSE;
+
+  return match_from (selector, selector->n_compounds - 1,
+                     element->compounds, element->n_compounds - 1);
+}
+
+/* The longhand properties a shorthand sets, so that shorthands and
+ * longhands are resolved together.
+ */
+static gchar **
+get_longhands (const gchar *property)
+{
+  GPtrArray *names;
+  gchar **result;
+  gint i;
+
+  result = g_hash_table_lookup (longhands, property);
+  if (result != NULL)
+    return result;
+
+  names = g_ptr_array_new ();
+
+  if (strcmp (property, "border") == 0)
+    {
+      for (i = 0; i < G_N_ELEMENTS (sides); i++)
+        {
+          g_ptr_array_add (names, g_strdup_printf ("border-%s-width", sides[i]));
+          g_ptr_array_add (names, g_strdup_printf ("border-%s-style", sides[i]));
+          g_ptr_array_add (names, g_strdup_printf ("border-%s-color", sides[i]));
+        }
+    }
+  else if (strcmp (property, "border-width") == 0 ||
+           strcmp (property, "border-style") == 0 ||
+           strcmp (property, "border-color") == 0)
+    {
+      for (i = 0; i < G_N_ELEMENTS (sides); i++)
+        g_ptr_array_add (names, g_strdup_printf ("border-%s-%s", sides[i],
+                                                 property + strlen ("border-")));
+    }
+  else if (strcmp (property, "border-radius") == 0)
+    {
+      for (i = 0; i < G_N_ELEMENTS (corners); i++)
+        g_ptr_array_add (names, g_strdup_printf ("border-%s-radius", corners[i]));
+    }
+  else if (strcmp (property, "border-image") == 0)
+    {
+      g_ptr_array_add (names, g_strdup ("border-image-source"));
+      g_ptr_array_add (names, g_strdup ("border-image-slice"));
+      g_ptr_array_add (names, g_strdup ("border-image-width"));
+      g_ptr_array_add (names, g_strdup ("border-image-repeat"));
+    }
+  else if (strcmp (property, "padding") == 0 ||
+           strcmp (property, "margin") == 0)
+    {
+      for (i = 0; i < G_N_ELEMENTS (sides); i++)
+        g_ptr_array_add (names, g_strdup_printf ("%s-%s", property, sides[i]));
+    }
+  else if (strcmp (property, "font") == 0)
+    {
+      g_ptr_array_add (names, g_strdup ("font-family"));
+      g_ptr_array_add (names, g_strdup ("font-size"));
+      g_ptr_array_add (names, g_strdup ("font-style"));
+      g_ptr_array_add (names, g_strdup ("font-variant"));
+      g_ptr_array_add (names, g_strdup ("font-weight"));
+    }
+  else
+    {
+      for (i = 0; i < G_N_ELEMENTS (sides); i++)
+        if (g_str_has_prefix (property, "border-") &&
+            strcmp (property + strlen ("border-"), sides[i]) == 0)
+          {
+            g_ptr_array_add (names, g_strdup_printf ("%s-width", property));
+            g_ptr_array_add (names, g_strdup_printf ("%s-style", property));
+            g_ptr_array_add (names, g_strdup_printf ("%s-color", property));
+          }
+
+      if (names->len == 0)
+        g_ptr_array_add (names, g_strdup (property));
+    }
+
+  g_ptr_array_add (names, NULL);
+  result = (gchar **) g_ptr_array_free (names, FALSE);
+  g_hash_table_insert (longhands, g_strdup (property), result);
+
+  return result;
+}
+
+static gboolean
+sets_longhand (const gchar *property,
+               const gchar *longhand)
+{
+  gchar **names;
+  gint i;
+
+  names = get_longhands (property);
+
+  for (i = 0; names[i] != NULL; i++)
+    if (strcmp (names[i], longhand) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+static const gchar *
+get_initial_value (const gchar *property)
+{
+  if (g_str_has_prefix (property, "border"))
+    {
+      if (g_str_has_suffix (property, "-width") ||
+          g_str_has_suffix (property, "-radius"))
+        return "0";
+      if (g_str_has_suffix (property, "-color"))
+        return "currentColor";
+      if (g_str_has_suffix (property, "-style"))
+        return "none";
+      if (g_str_has_prefix (property, "border-image"))
+        return "none";
+    }
+
+  if (strcmp (property, "background-color") == 0)
+    return "transparent";
+
+  if (strcmp (property, "background-image") == 0 ||
+      g_str_has_suffix (property, "-shadow"))
+    return "none";
+
+  return NULL;
+}
+
+static gchar *
+find_source (const gchar *name)
+{
+  gchar *path;
+  gint i;
+
+  if (g_str_has_prefix (name, "resource:///org/gnome/adwaita/"))
+    name += strlen ("resource:///org/gnome/adwaita/");
+
+  for (i = 0; source_dirs != NULL && source_dirs[i] != NULL; i++)
+    {
+      path = g_build_filename (source_dirs[i], name, NULL);
+
+      if (g_file_test (path, G_FILE_TEST_EXISTS))
+        return path;
+
+      g_free (path);
+    }
+
+  return g_strdup (name);
+}
+
+static gchar *
+get_import_name (const gchar *statement)
+{
+  const gchar *start, *end;
+
+  start = strchr (statement, '"');
+  if (start == NULL)
+    return NULL;
+
+  end = strchr (start + 1, '"');
+  if (end == NULL)
+    return NULL;
+
+  return g_strndup (start + 1, end - start - 1);
+}
+
+static void
+add_color (StyleSheet  *sheet,
+           const gchar *statement)
+{
+  gchar **parts;
+
+  /* "@define-color name value" */
+  parts = g_strsplit (statement, " ", 3);
+
+  if (g_strv_length (parts) == 3)
+    {
+      if (!g_hash_table_lookup (sheet->colors, parts[1]))
+        g_ptr_array_add (sheet->color_names, g_strdup (parts[1]));
+
+      g_hash_table_insert (sheet->colors, g_strdup (parts[1]), g_strdup (parts[2]));
+    }
+
+  g_strfreev (parts);
+}
+
+static void
+add_rule (StyleSheet  *sheet,
+          const gchar *str,
+          gsize        len)
+{
+  GPtrArray *selectors;
+  Declaration *declaration;
+  Rule *rule;
+  gsize selector_len, body_len, n;
+  const gchar *body;
+  gchar *text, *colon;
+  guint d;
+  gint s;
+
+  selector_len = scan_to (str, len, '{');
+  if (selector_len == len)
+    return;
+
+  rule = g_slice_new0 (Rule);
+  rule->properties = g_ptr_array_new_with_free_func (g_free);
+  rule->values = g_ptr_array_new_with_free_func (g_free);
+
+  selectors = g_ptr_array_new ();
+
+  while (selector_len > 0)
+    {
+      n = scan_to (str, selector_len, ',');
+      g_ptr_array_add (selectors, parse_selector (collapse_whitespace (str, n)));
+
+      if (n == selector_len)
+        break;
+
+      str += n + 1;
+      len -= n + 1;
+      selector_len -= n + 1;
+    }
+
+  rule->n_selectors = selectors->len;
+  rule->selectors = (Selector **) g_ptr_array_free (selectors, FALSE);
+
+  body = str + selector_len + 1;
+  body_len = len - selector_len - 1;
+
+  /* drop the closing brace */
+  if (body_len > 0 && body[body_len - 1] == '}')
+    body_len--;
+
+  while (body_len > 0)
+    {
+      n = scan_to (body, body_len, ';');
+      text = g_strndup (body, n);
+      colon = strchr (text, ':');
+
+      if (colon != NULL)
+        {
+          *colon = '\0';
+          g_ptr_array_add (rule->properties, collapse_whitespace (text, strlen (text)));
+          g_ptr_array_add (rule->values, collapse_whitespace (colon + 1, strlen (colon + 1)));
+        }
+
+      g_free (text);
+
+      if (n == body_len)
+        break;
+
+      body += n + 1;
+      body_len -= n + 1;
+    }
+
+  rule->declarations = g_new (Declaration *, rule->n_selectors * rule->properties->len);
+
+  for (s = 0; s < rule->n_selectors; s++)
+    {
+      add_type_classes (rule->selectors[s]);
+
+      for (d = 0; d < rule->properties->len; d++)
+        {
+          declaration = g_slice_new0 (Declaration);
+          declaration->rule = rule;
+          declaration->selector = rule->selectors[s];
+          declaration->position = sheet->rules->len;
+          declaration->index = d;
+          declaration->property = g_ptr_array_index (rule->properties, d);
+          declaration->value = g_ptr_array_index (rule->values, d);
+
+          rule->declarations[s * rule->properties->len + d] = declaration;
+          g_ptr_array_add (sheet->declarations, declaration);
+        }
+    }
+
+  g_ptr_array_add (sheet->rules, rule);
+}
+
+static gboolean
+load_stylesheet (StyleSheet   *sheet,
+                 const gchar  *name,
+                 GError      **error)
+{
+  gchar *path, *contents, *statement, *import;
+  const gchar *p;
+  gsize len, n, block;
+  gint depth;
+
+  path = find_source (name);
+
+  if (!g_file_get_contents (path, &contents, NULL, error))
+    {
+      g_free (path);
+      return FALSE;
+    }
+
+  strip_comments (contents);
+  p = contents;
+
+  while (*p != '\0')
+    {
+      while (g_ascii_isspace (*p))
+        p++;
+
+      if (*p == '\0')
+        break;
+
+      /* a statement ends with a ';' or its outermost block, which
+       * may nest, e.g. for @keyframes.
+       */
+      len = strlen (p);
+      n = scan_to (p, len, ';');
+      block = scan_to (p, len, '{');
+
+      if (block < n)
+        {
+          for (n = block, depth = 0; n < len; n++)
+            {
+              if (p[n] == '{')
+                depth++;
+              else if (p[n] == '}' && --depth == 0)
+                break;
+            }
+        }
+
+      if (n < len)
+        n++;
+
+      sheet->size += n;
+
+      if (g_str_has_prefix (p, "@import"))
+        {
+          statement = g_strndup (p, n);
+          import = get_import_name (statement);
+          g_free (statement);
+
+          if (import != NULL && !load_stylesheet (sheet, import, error))
+            {
+              g_free (import);
+              g_free (contents);
+              g_free (path);
+              return FALSE;
+            }
+
+          g_free (import);
+        }
+      else if (g_str_has_prefix (p, "@define-color"))
+        {
+          statement = collapse_whitespace (p, n - (p[n - 1] == ';' ? 1 : 0));
+          add_color (sheet, statement);
+          g_free (statement);
+        }
+      else if (*p == '@')
+        g_ptr_array_add (sheet->at_rules, collapse_whitespace (p, n));
+      else
+        add_rule (sheet, p, n);
+
+      p += n;
+    }
+
+  g_free (contents);
+  g_free (path);
+
+  return TRUE;
+}
+
+static gboolean
+declaration_outranks (Declaration *a,
+                      Declaration *b)
+{
+  if (a->selector->specificity != b->selector->specificity)
+    return a->selector->specificity > b->selector->specificity;
+
+  if (a->position != b->position)
+    return a->position > b->position;
+
+  return a->index > b->index;
+}
+
+/* Whether both set the same value; a reset is the same as no
+ * declaration at all.
+ */
+static gboolean
+same_value (Declaration *a,
+            Declaration *b)
+{
+  if (a == NULL || a->value == NULL)
+    return (b == NULL || b->value == NULL);
+
+  if (b == NULL || b->value == NULL)
+    return FALSE;
+
+  return strcmp (a->property, b->property) == 0 &&
+         strcmp (a->value, b->value) == 0;
+}
+
+static gchar *
+get_declaration_key (Declaration *declaration)
+{
+  return g_strconcat (declaration->selector->key, "\n", declaration->property, NULL);
+}
+
+/* Maps every longhand to the declaration that sets it on @element,
+ * or with @all, to every declaration that does.
+ */
+static GHashTable *
+resolve_element (StyleSheet *sheet,
+                 Selector   *element,
+                 gboolean    all)
+{
+  GHashTable *result;
+  Declaration *declaration, *current;
+  GPtrArray *list;
+  gchar **names;
+  guint i;
+  gint n;
+
+  if (all)
+    result = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                    (GDestroyNotify) g_ptr_array_unref);
+  else
+    result = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (i = 0; i < sheet->declarations->len; i++)
+    {
+      declaration = g_ptr_array_index (sheet->declarations, i);
+
+      if (!selector_matches (declaration->selector, element))
+        continue;
+
+      names = get_longhands (declaration->property);
+
+      for (n = 0; names[n] != NULL; n++)
+        {
+          if (all)
+            {
+              list = g_hash_table_lookup (result, names[n]);
+
+              if (list == NULL)
+                {
+                  list = g_ptr_array_new ();
+                  g_hash_table_insert (result, names[n], list);
+                }
+
+              g_ptr_array_add (list, declaration);
+              continue;
+            }
+
+          current = g_hash_table_lookup (result, names[n]);
+
+          if (current == NULL || declaration_outranks (declaration, current))
+            g_hash_table_insert (result, names[n], declaration);
+        }
+    }
+
+  return result;
+}
+
+static GPtrArray *
+get_elements (StyleSheet *light,
+              StyleSheet *dark)
+{
+  StyleSheet *sheets[] = { light, dark };
+  GHashTable *seen;
+  GPtrArray *elements;
+  Element *element;
+  Rule *rule;
+  guint i;
+  gint s, r;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  elements = g_ptr_array_new ();
+
+  for (s = 0; s < G_N_ELEMENTS (sheets); s++)
+    for (i = 0; i < sheets[s]->rules->len; i++)
+      {
+        rule = g_ptr_array_index (sheets[s]->rules, i);
+
+        for (r = 0; r < rule->n_selectors; r++)
+          {
+            if (g_hash_table_contains (seen, rule->selectors[r]->key))
+              continue;
+
+            g_hash_table_add (seen, rule->selectors[r]->key);
+
+            element = g_slice_new (Element);
+            element->selector = rule->selectors[r];
+            element->light = resolve_element (light, element->selector, FALSE);
+            element->dark = resolve_element (dark, element->selector, TRUE);
+            g_ptr_array_add (elements, element);
+          }
+      }
+
+  g_hash_table_destroy (seen);
+
+  return elements;
+}
+
+static void
+add_override (GPtrArray   *overrides,
+              GHashTable  *override_keys,
+              Selector    *selector,
+              const gchar *property,
+              const gchar *value)
+{
+  Declaration *declaration;
+
+  declaration = g_slice_new0 (Declaration);
+  declaration->selector = selector;
+  declaration->position = -1;
+  declaration->index = overrides->len;
+  declaration->property = property;
+  declaration->value = value;
+  declaration->keep = TRUE;
+
+  g_ptr_array_add (overrides, declaration);
+  g_hash_table_add (override_keys, get_declaration_key (declaration));
+}
+
+/* Adds to the delta what @element needs to get the dark value of
+ * @longhand, if anything. Returns FALSE with @error set if it can't be
+ * expressed.
+ */
+static gboolean
+fix_longhand (Element      *element,
+              const gchar  *longhand,
+              GPtrArray    *overrides,
+              GHashTable   *override_keys,
+              GHashTable   *dark_keys,
+              gboolean     *changed,
+              GError      **error)
+{
+  Declaration *best = NULL, *winner = NULL, *light, *declaration;
+  const gchar *property;
+  GPtrArray *list;
+  gchar *key;
+  gboolean found;
+  guint i;
+
+  list = g_hash_table_lookup (element->dark, longhand);
+
+  for (i = 0; list != NULL && i < list->len; i++)
+    {
+      declaration = g_ptr_array_index (list, i);
+
+      if (winner == NULL || declaration_outranks (declaration, winner))
+        winner = declaration;
+
+      if (declaration->keep && (best == NULL || declaration_outranks (declaration, best)))
+        best = declaration;
+    }
+
+  for (i = 0; i < overrides->len; i++)
+    {
+      declaration = g_ptr_array_index (overrides, i);
+
+      if (sets_longhand (declaration->property, longhand) &&
+          selector_matches (declaration->selector, element->selector) &&
+          (best == NULL || declaration_outranks (declaration, best)))
+        best = declaration;
+    }
+
+  light = g_hash_table_lookup (element->light, longhand);
+
+  if (same_value (best != NULL ? best : light, winner))
+    return TRUE;
+
+  *changed = TRUE;
+
+  /* the dark sheet dropped the light declaration: override it where
+   * it applies, below anything else in the delta
+   */
+  if (best == NULL && light != NULL &&
+      (winner == NULL || strcmp (winner->property, light->property) == 0))
+    {
+      key = get_declaration_key (light);
+      found = g_hash_table_contains (dark_keys, key) ||
+              g_hash_table_contains (override_keys, key);
+      g_free (key);
+
+      if (!found)
+        {
+          add_override (overrides, override_keys, light->selector, light->property,
+                        winner != NULL ? winner->value : NULL);
+          return TRUE;
+        }
+    }
+
+  if (winner != NULL && !winner->keep)
+    {
+      winner->keep = TRUE;
+      return TRUE;
+    }
+
+  /* an override on a broader selector hides the dark value here */
+  if (best != NULL && best->rule == NULL &&
+      strcmp (best->selector->key, element->selector->key) != 0)
+    {
+      property = winner != NULL ? winner->property : best->property;
+      key = g_strconcat (element->selector->key, "\n", property, NULL);
+      found = g_hash_table_contains (override_keys, key);
+      g_free (key);
+
+      if (!found)
+        {
+          add_override (overrides, override_keys, element->selector, property,
+                        winner != NULL ? winner->value : NULL);
+          return TRUE;
+        }
+    }
+
+  g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+               "Unable to give '%s' its dark '%s'",
+               element->selector->text, longhand);
+
+  return FALSE;
+}
+
+static gboolean
+compute_delta (StyleSheet  *light,
+               StyleSheet  *dark,
+               GPtrArray   *overrides,
+               GError     **error)
+{
+  GHashTable *dark_keys, *override_keys, *names;
+  GHashTableIter iter;
+  GPtrArray *elements;
+  Element *element;
+  Declaration *declaration;
+  const gchar *longhand;
+  gboolean changed = TRUE, success = TRUE;
+  guint i;
+
+  dark_keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  override_keys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (i = 0; i < dark->declarations->len; i++)
+    {
+      declaration = g_ptr_array_index (dark->declarations, i);
+      g_hash_table_add (dark_keys, get_declaration_key (declaration));
+    }
+
+  elements = get_elements (light, dark);
+  names = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* every addition can change what wins elsewhere, so go over all the
+   * elements again until nothing needs to be added
+   */
+  while (changed && success)
+    {
+      changed = FALSE;
+
+      for (i = 0; i < elements->len && success; i++)
+        {
+          element = g_ptr_array_index (elements, i);
+
+          g_hash_table_remove_all (names);
+
+          g_hash_table_iter_init (&iter, element->light);
+          while (g_hash_table_iter_next (&iter, (gpointer *) &longhand, NULL))
+            g_hash_table_add (names, (gpointer) longhand);
+
+          g_hash_table_iter_init (&iter, element->dark);
+          while (g_hash_table_iter_next (&iter, (gpointer *) &longhand, NULL))
+            g_hash_table_add (names, (gpointer) longhand);
+
+          g_hash_table_iter_init (&iter, names);
+          while (success && g_hash_table_iter_next (&iter, (gpointer *) &longhand, NULL))
+            success = fix_longhand (element, longhand, overrides, override_keys,
+                                    dark_keys, &changed, error);
+        }
+    }
+
+  for (i = 0; i < elements->len; i++)
+    {
+      element = g_ptr_array_index (elements, i);
+      g_hash_table_destroy (element->light);
+      g_hash_table_destroy (element->dark);
+      g_slice_free (Element, element);
+    }
+
+  g_ptr_array_free (elements, TRUE);
+  g_hash_table_destroy (names);
+  g_hash_table_destroy (override_keys);
+  g_hash_table_destroy (dark_keys);
+
+  return success;
+}
+
+static void
+write_rule (GString *output,
+            Rule    *rule)
+{
+  GPtrArray *subsets;
+  GString *subset;
+  guint d, j;
+  gint s;
+
+  /* declarations kept for the same selectors go in the same rule */
+  subsets = g_ptr_array_new_with_free_func (g_free);
+
+  for (d = 0; d < rule->properties->len; d++)
+    {
+      subset = g_string_new (NULL);
+
+      for (s = 0; s < rule->n_selectors; s++)
+        g_string_append_c (subset, rule->declarations[s * rule->properties->len + d]->keep ? '1' : '0');
+
+      if (strchr (subset->str, '1') == NULL)
+        {
+          g_string_free (subset, TRUE);
+          continue;
+        }
+
+      for (j = 0; j < subsets->len; j++)
+        if (strcmp (g_ptr_array_index (subsets, j), subset->str) == 0)
+          break;
+
+      if (j == subsets->len)
+        g_ptr_array_add (subsets, g_strdup (subset->str));
+
+      g_string_free (subset, TRUE);
+    }
+
+  for (j = 0; j < subsets->len; j++)
+    {
+      const gchar *mask = g_ptr_array_index (subsets, j);
+      gboolean first = TRUE;
+
+      for (s = 0; s < rule->n_selectors; s++)
+        {
+          if (mask[s] != '1')
+            continue;
+
+          g_string_append_printf (output, "%s%s", first ? "" : ",\n", rule->selectors[s]->text);
+          first = FALSE;
+        }
+
+      g_string_append (output, " {\n");
+
+      for (d = 0; d < rule->properties->len; d++)
+        {
+          for (s = 0; s < rule->n_selectors; s++)
+            if ((mask[s] == '1') != rule->declarations[s * rule->properties->len + d]->keep)
+              break;
+
+          if (s == rule->n_selectors)
+            g_string_append_printf (output, "    %s: %s;\n",
+                                    (gchar *) g_ptr_array_index (rule->properties, d),
+                                    (gchar *) g_ptr_array_index (rule->values, d));
+        }
+
+      g_string_append (output, "}\n\n");
+    }
+
+  g_ptr_array_free (subsets, TRUE);
+}
+
+static gchar *
+write_delta (StyleSheet   *light,
+             StyleSheet   *dark,
+             GPtrArray    *overrides,
+             const gchar  *light_name,
+             const gchar  *dark_name,
+             GError      **error)
+{
+  Declaration *declaration;
+  GString *output;
+  const gchar *name, *value;
+  guint i, j;
+
+  output = g_string_new (NULL);
+  g_string_append_printf (output,
+                          "/* Generated by create-dark-delta from %s and %s, do not edit.\n"
+                          " * Load on top of %s with a higher priority to get %s.\n"
+                          " */\n\n",
+                          light_name, dark_name, light_name, dark_name);
+
+  for (i = 0; i < dark->color_names->len; i++)
+    {
+      name = g_ptr_array_index (dark->color_names, i);
+      value = g_hash_table_lookup (dark->colors, name);
+
+      if (g_strcmp0 (value, g_hash_table_lookup (light->colors, name)) != 0)
+        g_string_append_printf (output, "@define-color %s %s;\n", name, value);
+    }
+
+  g_string_append_c (output, '\n');
+
+  for (i = 0; i < dark->at_rules->len; i++)
+    {
+      for (j = 0; j < light->at_rules->len; j++)
+        if (strcmp (g_ptr_array_index (dark->at_rules, i),
+                    g_ptr_array_index (light->at_rules, j)) == 0)
+          break;
+
+      if (j == light->at_rules->len)
+        g_string_append_printf (output, "%s\n\n",
+                                (gchar *) g_ptr_array_index (dark->at_rules, i));
+    }
+
+  /* first, so that the dark declarations outrank them */
+  for (i = 0; i < overrides->len; i++)
+    {
+      declaration = g_ptr_array_index (overrides, i);
+      value = declaration->value;
+
+      if (value == NULL)
+        value = get_initial_value (declaration->property);
+
+      if (value == NULL)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                       "Don't know how to reset '%s' for '%s'",
+                       declaration->property, declaration->selector->text);
+          return g_string_free (output, TRUE);
+        }
+
+      g_string_append_printf (output, "%s {\n    %s: %s;\n}\n\n",
+                              declaration->selector->text, declaration->property, value);
+    }
+
+  for (i = 0; i < dark->rules->len; i++)
+    write_rule (output, g_ptr_array_index (dark->rules, i));
+
+  return g_string_free (output, FALSE);
+}
+
+static guint
+count_kept (StyleSheet *sheet)
+{
+  Declaration *declaration;
+  guint i, n = 0;
+
+  for (i = 0; i < sheet->declarations->len; i++)
+    {
+      declaration = g_ptr_array_index (sheet->declarations, i);
+
+      if (declaration->keep)
+        n++;
+    }
+
+  return n;
+}
+
+static void
+style_sheet_init (StyleSheet *sheet)
+{
+  sheet->rules = g_ptr_array_new ();
+  sheet->declarations = g_ptr_array_new ();
+  sheet->color_names = g_ptr_array_new_with_free_func (g_free);
+  sheet->colors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  sheet->at_rules = g_ptr_array_new_with_free_func (g_free);
+  sheet->size = 0;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  StyleSheet light, dark;
+  GPtrArray *overrides;
+  gchar *delta;
+  gsize delta_size;
+  guint n_kept;
+
+  context = g_option_context_new ("LIGHT DARK OUTPUT - write the dark stylesheet as overrides of the light one");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
+  if (argc != 4)
+    {
+      g_printerr ("Usage: %s [--sourcedir DIR...] LIGHT DARK OUTPUT\n", argv[0]);
+      return 1;
+    }
+
+  type_classes = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                        (GDestroyNotify) g_hash_table_destroy);
+  longhands = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                     (GDestroyNotify) g_strfreev);
+
+  style_sheet_init (&light);
+  style_sheet_init (&dark);
+
+  if (!load_stylesheet (&light, argv[1], &error) ||
+      !load_stylesheet (&dark, argv[2], &error))
+    {
+      g_printerr ("Unable to load the stylesheets: %s\n", error->message);
+      return 1;
+    }
+
+  overrides = g_ptr_array_new ();
+
+  if (!compute_delta (&light, &dark, overrides, &error))
+    {
+      g_printerr ("Unable to compute the difference: %s\n", error->message);
+      return 1;
+    }
+
+  delta = write_delta (&light, &dark, overrides, argv[1], argv[2], &error);
+
+  if (delta == NULL)
+    {
+      g_printerr ("Unable to write the difference: %s\n", error->message);
+      return 1;
+    }
+
+  if (!g_file_set_contents (argv[3], delta, -1, &error))
+    {
+      g_printerr ("Unable to write %s: %s\n", argv[3], error->message);
+      return 1;
+    }
+
+  n_kept = count_kept (&dark) + overrides->len;
+  delta_size = strlen (delta);
+
+  g_print ("%s: %u rules, %u declarations, %" G_GSIZE_FORMAT " bytes\n",
+           argv[1], light.rules->len, light.declarations->len, light.size);
+  g_print ("%s: %u rules, %u declarations, %" G_GSIZE_FORMAT " bytes\n",
+           argv[2], dark.rules->len, dark.declarations->len, dark.size);
+  g_print ("%s: %u declarations (%.0f%%), %" G_GSIZE_FORMAT " bytes (%.0f%%)\n",
+           argv[3], n_kept, 100.0 * n_kept / MAX (dark.declarations->len, 1),
+           delta_size, 100.0 * delta_size / MAX (dark.size, 1));
+
+  g_free (delta);
+
+  return 0;
+}
@@ -0,0 +1,162 @@
+/* Adwaita - render-scaled-assets
+ *
+ * Copyright (C) 2026 The GNOME Project
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <librsvg/rsvg.h>
+#include <cairo.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Renders a scaled variant (e.g. name@2.png) of every asset listed in
+ * the index from the source SVG, so that displays with a scale factor
+ * don't have to upscale the 1x PNGs at runtime. The 1x PNG is used to
+ * size the output, so that both variants line up exactly.
+ */
+
+static gboolean
+render_asset (RsvgHandle *handle,
+              const gchar *id,
+              const gchar *source_dir,
+              const gchar *dest_dir,
+              gint scale)
+{
+  RsvgDimensionData dimensions;
+  RsvgPositionData position;
+  cairo_surface_t *source, *surface;
+  cairo_t *cr;
+  gchar *sub_id, *name, *path;
+  gint width, height;
+  gboolean retval = FALSE;
+
+  sub_id = g_strconcat ("#", id, NULL);
+
+  if (!rsvg_handle_get_dimensions_sub (handle, &dimensions, sub_id) ||
+      !rsvg_handle_get_position_sub (handle, &position, sub_id))
+    {
+      g_printerr ("No element '%s' in the source SVG\n", id);
+      g_free (sub_id);
+      return FALSE;
+    }
+
+  name = g_strconcat (id, ".png", NULL);
+  path = g_build_filename (source_dir, name, NULL);
+  source = cairo_image_surface_create_from_png (path);
+  g_free (name);
+  g_free (path);
+
+  if (cairo_surface_status (source) == CAIRO_STATUS_SUCCESS)
+    {
+      width = cairo_image_surface_get_width (source);
+      height = cairo_image_surface_get_height (source);
+    }
+  else
+    {
+      width = ceil (dimensions.width);
+      height = ceil (dimensions.height);
+    }
+
+  cairo_surface_destroy (source);
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        width * scale, height * scale);
+  cr = cairo_create (surface);
+
+  /* center the element in the 1x box, like the 1x export does */
+  cairo_scale (cr, scale, scale);
+  cairo_translate (cr,
+                   (width - dimensions.width) / 2.0 - position.x,
+                   (height - dimensions.height) / 2.0 - position.y);
+  rsvg_handle_render_cairo_sub (handle, cr, sub_id);
+  cairo_destroy (cr);
+
+  name = g_strdup_printf ("%s@%d.png", id, scale);
+  path = g_build_filename (dest_dir, name, NULL);
+
+  if (cairo_surface_write_to_png (surface, path) == CAIRO_STATUS_SUCCESS)
+    retval = TRUE;
+  else
+    g_printerr ("Unable to write %s\n", path);
+
+  cairo_surface_destroy (surface);
+  g_free (sub_id);
+  g_free (name);
+  g_free (path);
+
+  return retval;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  RsvgHandle *handle;
+  GError *error = NULL;
+  gchar *index, **ids;
+  gint idx, scale, failed = 0;
+
+  if (argc != 6)
+    {
+      g_printerr ("Usage: %s SVG INDEX SOURCE-DIR DEST-DIR SCALE\n", argv[0]);
+      return 1;
+    }
+
+  g_type_init ();
+
+  scale = atoi (argv[5]);
+  if (scale < 2)
+    {
+      g_printerr ("Invalid scale '%s'\n", argv[5]);
+      return 1;
+    }
+
+  handle = rsvg_handle_new_from_file (argv[1], &error);
+  if (handle == NULL)
+    {
+      g_printerr ("Unable to load %s: %s\n", argv[1], error->message);
+      return 1;
+    }
+
+  if (!g_file_get_contents (argv[2], &index, NULL, &error))
+    {
+      g_printerr ("Unable to read %s: %s\n", argv[2], error->message);
+      return 1;
+    }
+
+  g_mkdir_with_parents (argv[4], 0755);
+  ids = g_strsplit (index, "\n", -1);
+
+  for (idx = 0; ids[idx] != NULL; idx++)
+    {
+      g_strstrip (ids[idx]);
+
+      if (ids[idx][0] == '\0')
+        continue;
+
+      if (!render_asset (handle, ids[idx], argv[3], argv[4], scale))
+        failed++;
+    }
+
+  g_strfreev (ids);
+  g_free (index);
+  g_object_unref (handle);
+
+  return failed ? 1 : 0;
+}
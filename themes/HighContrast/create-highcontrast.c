@@ -1,80 +1,37 @@
 #include <cairo/cairo.h>
 #include <gio/gio.h>
-#include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
 #include <glib.h>
+#include <librsvg/rsvg.h>
 #include <string.h>
 #include <math.h>
+#include <unistd.h>
+
+#include "highcontrast-invert.h"
 
 GFile *gnome_dir = NULL;
 GFile *hc_dir = NULL;
+GFile *inverse_dir = NULL;
 
 static const gint icon_sizes[] = {
   16, 22, 24, 32, 48, 256
 };
 
-static char *
-replace_str (char *str,
-             const char *substr,
-             const char *new_substr)
-{
-  static char buf[4096];
-  char *ptr;
-
-  /* if we didn't find the substring, return */
-  if (!(ptr = (char*)strstr (str, substr)))
-    return str;
-
-  /* copy up to the substring */
-  strncpy (buf, str, ptr - str);
-  buf[ptr - str] = '\0';
-
-  if (strlen (substr) >=strlen (new_substr))
-    {
-      sprintf (buf + (ptr - str), "%s%s", new_substr, ptr + strlen (substr));
-    }
-  else
-    {
-      static char buf2[4096];
-
-      strncpy (buf2, str, ptr - str + strlen (substr));
-      buf2[ptr - str + strlen (substr)] = '\0';
-
-      sprintf (buf2 + (ptr - str), "%s%s", new_substr, ptr + strlen (substr));
-      strncpy (buf, buf2, strlen (buf));
-    }
-
-  return buf;
-}
-
+/* Returns a copy of @str with the first occurrence of @substr replaced */
 static gchar *
-ensure_dest_path (GFile *file,
-                  gint icon_size)
+replace_str (const gchar *str,
+             const gchar *substr,
+             const gchar *new_substr)
 {
-  gchar *str, *str2, *size_string, *dest_path;
-  GFile *dest_file, *dest_dir, *tmp;
-
-  str = g_file_get_relative_path (gnome_dir, file);
-  tmp = g_file_resolve_relative_path (hc_dir, str);
-  g_free (str);
-
-  str = g_file_get_path (tmp);
-  size_string = g_strdup_printf ("%dx%d", icon_size, icon_size);
-  str2 = replace_str (str, "-symbolic.svg", ".png");
-  dest_path = replace_str (str2, "scalable", size_string);
+  const gchar *ptr;
 
-  dest_file = g_file_new_for_path (dest_path);
-  dest_dir = g_file_get_parent (dest_file);
-
-  g_file_make_directory_with_parents (dest_dir, NULL, NULL);
-
-  g_object_unref (dest_file);
-  g_object_unref (dest_dir);
-  g_object_unref (tmp);
-  g_free (str);
-  g_free (size_string);
+  ptr = strstr (str, substr);
+  if (ptr == NULL)
+    return g_strdup (str);
 
-  return dest_path;
+  return g_strdup_printf ("%.*s%s%s",
+                          (gint) (ptr - str), str,
+                          new_substr, ptr + strlen (substr));
 }
 
 static void
@@ -85,13 +42,32 @@ optimize_png (const gchar *png_path)
   g_free (cmd);
 }
 
-static GdkPixbuf *
-get_recolored_svg (GFile *file,
-                   gint icon_size)
+typedef struct {
+  const gchar *name;
+  gint n_threads;
+  GMutex lock;
+  guint n_items;
+  gint64 busy_time;
+} Stage;
+
+/* Parsing is the part of librsvg that isn't safe to run from several
+ * threads: it goes through libxml2 and its XInclude support, and older
+ * librsvg lazily sets up global parser state. Only one renderer at a
+ * time parses an SVG; rasterizing a parsed handle only touches that
+ * handle and the renderer's own surface, so it runs in parallel like
+ * outlining, inverting and compositing.
+ */
+static GMutex svg_lock;
+static Stage parse_stage = { "parse", 1 };
+static gint64 svg_lock_wait_time = 0;
+
+static RsvgHandle *
+get_recolored_svg (GFile *file)
 {
   gchar *data, *str;
-  GdkPixbuf *pixbuf;
+  RsvgHandle *handle;
   GInputStream *stream;
+  gint64 start, locked;
 
   str = g_file_get_path (file);
   data = g_strconcat ("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
@@ -119,13 +95,25 @@ get_recolored_svg (GFile *file,
                       NULL);
 
   stream = g_memory_input_stream_new_from_data (data, -1, g_free);
-  pixbuf = gdk_pixbuf_new_from_stream_at_scale (stream,
-                                                icon_size, icon_size,
-                                                TRUE, NULL, NULL);
+
+  start = g_get_monotonic_time ();
+  g_mutex_lock (&svg_lock);
+  locked = g_get_monotonic_time ();
+
+  /* the SVG itself as base, so that it's allowed to include itself */
+  handle = rsvg_handle_new_from_stream_sync (stream, file,
+                                             RSVG_HANDLE_FLAGS_NONE,
+                                             NULL, NULL);
+
+  parse_stage.n_items++;
+  parse_stage.busy_time += g_get_monotonic_time () - locked;
+  svg_lock_wait_time += locked - start;
+  g_mutex_unlock (&svg_lock);
+
   g_object_unref (stream);
   g_free (str);
 
-  return pixbuf;
+  return handle;
 }
 
 /* taken from gdkcairo.c */
@@ -247,135 +235,617 @@ _gdk_cairo_region_create_from_surface (cairo_surface_t *surface)
   return region;
 }
 
+/* The generator runs as a pipeline: a scanner walks the symbolic theme
+ * and queues an item per SVG and size, renderer threads turn items into
+ * surfaces and writer threads encode those as PNG files. The queues
+ * between the stages are bounded so that a slow stage holds the others
+ * back instead of piling up surfaces in memory.
+ */
+#define QUEUE_CAPACITY 64
+
+typedef struct {
+  GMutex lock;
+  GCond not_empty;
+  GCond not_full;
+  GQueue items;
+  guint capacity;
+  gboolean closed;
+
+  /* statistics */
+  guint n_pushed;
+  guint64 occupancy_sum;
+  guint max_occupancy;
+  gint64 full_time;
+  gint64 empty_time;
+} BoundedQueue;
+
+typedef struct {
+  GFile *file;
+  gchar *dest_path;
+  gchar *inverse_path;
+  gint icon_size;
+  cairo_surface_t *surface;
+  cairo_surface_t *inverse_surface;
+} Item;
+
+static gint n_renderers = 0;
+static gint n_writers = 2;
+static gchar *inverse_theme = NULL;
+
+static GOptionEntry entries[] = {
+  { "renderers", 'r', 0, G_OPTION_ARG_INT, &n_renderers,
+    "Number of rendering threads, one per core by default", "N" },
+  { "writers", 'w', 0, G_OPTION_ARG_INT, &n_writers,
+    "Number of PNG writing threads", "N" },
+  { "inverse", 'i', 0, G_OPTION_ARG_FILENAME, &inverse_theme,
+    "Also write the inverted icons to the theme in DIR", "DIR" },
+  { NULL }
+};
+
+static BoundedQueue render_queue;
+static BoundedQueue write_queue;
+static Stage scan_stage = { "scan", 1 };
+static Stage render_stage = { "render" };
+static Stage write_stage = { "write" };
+static Stage invert_stage = { "invert" };
+static gint renderers_running = 0;
+
+static void
+bounded_queue_init (BoundedQueue *queue,
+                    guint         capacity)
+{
+  memset (queue, 0, sizeof (BoundedQueue));
+  g_mutex_init (&queue->lock);
+  g_cond_init (&queue->not_empty);
+  g_cond_init (&queue->not_full);
+  g_queue_init (&queue->items);
+  queue->capacity = capacity;
+}
+
 static void
-write_png_theme (GList *svg_files,
-                 gint icon_size)
+bounded_queue_clear (BoundedQueue *queue)
 {
-  GList *l;
+  g_mutex_clear (&queue->lock);
+  g_cond_clear (&queue->not_empty);
+  g_cond_clear (&queue->not_full);
+}
+
+static void
+bounded_queue_push (BoundedQueue *queue,
+                    gpointer      item)
+{
+  gint64 start;
 
-  g_print ("Writing size: %dx%d\n", icon_size, icon_size);
+  g_mutex_lock (&queue->lock);
 
-  for (l = svg_files; l != NULL; l = l->next)
+  if (queue->items.length >= queue->capacity)
     {
-      GFile *file;
-      gchar *dest_path;
-      GdkPixbuf *pixbuf;
-      gint border_offset;
-      cairo_surface_t *surface;
-      cairo_region_t *region;
-      cairo_t *cr;
-
-      file = l->data;
-      border_offset = (gint) floor (icon_size / 16);
-      pixbuf = get_recolored_svg (file, icon_size - 2.0 * border_offset);
-
-      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                            icon_size, icon_size);
-      cr = cairo_create (surface);
-
-      gdk_cairo_set_source_pixbuf (cr, pixbuf,
-                                   border_offset, border_offset);
-      cairo_paint (cr);
-      cairo_destroy (cr);
+      start = g_get_monotonic_time ();
 
-      region = _gdk_cairo_region_create_from_surface (surface);
-      cairo_surface_destroy (surface);
+      while (queue->items.length >= queue->capacity)
+        g_cond_wait (&queue->not_full, &queue->lock);
 
-      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                            icon_size, icon_size);
-      cr = cairo_create (surface);
+      queue->full_time += g_get_monotonic_time () - start;
+    }
 
-      cairo_save (cr);
-      gdk_cairo_region (cr, region);
+  g_queue_push_tail (&queue->items, item);
+  queue->n_pushed++;
+  queue->occupancy_sum += queue->items.length;
+  queue->max_occupancy = MAX (queue->max_occupancy, queue->items.length);
 
-      cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
-      cairo_set_line_width (cr, 2.0 * border_offset);
-      cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-      cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+  g_cond_signal (&queue->not_empty);
+  g_mutex_unlock (&queue->lock);
+}
 
-      cairo_stroke (cr);
-      cairo_restore (cr);
+/* Returns NULL once the queue is closed and empty */
+static gpointer
+bounded_queue_pop (BoundedQueue *queue)
+{
+  gpointer item;
+  gint64 start;
 
-      gdk_cairo_set_source_pixbuf (cr, pixbuf,
-                                   border_offset, border_offset);
-      cairo_paint (cr);
+  g_mutex_lock (&queue->lock);
 
-      dest_path = ensure_dest_path (file, icon_size);
-      cairo_surface_write_to_png (surface, dest_path);
+  if (queue->items.length == 0 && !queue->closed)
+    {
+      start = g_get_monotonic_time ();
 
-      cairo_destroy (cr);
-      cairo_surface_destroy (surface);
-      cairo_region_destroy (region);
-      g_object_unref (pixbuf);
+      while (queue->items.length == 0 && !queue->closed)
+        g_cond_wait (&queue->not_empty, &queue->lock);
 
-      optimize_png (dest_path);
+      queue->empty_time += g_get_monotonic_time () - start;
     }
+
+  item = g_queue_pop_head (&queue->items);
+
+  if (item != NULL)
+    g_cond_signal (&queue->not_full);
+
+  g_mutex_unlock (&queue->lock);
+
+  return item;
 }
 
 static void
-process (int argc,
-         char **argv)
+bounded_queue_close (BoundedQueue *queue)
 {
-  GList *svg_files = NULL;
-  GQueue *descend_into_files;
-  GFile *current_dir, *symbolic_theme, *file;
-  gchar *str;
+  g_mutex_lock (&queue->lock);
+  queue->closed = TRUE;
+  g_cond_broadcast (&queue->not_empty);
+  g_mutex_unlock (&queue->lock);
+}
+
+static void
+stage_add (Stage  *stage,
+           guint   n_items,
+           gint64  busy_time)
+{
+  g_mutex_lock (&stage->lock);
+  stage->n_items += n_items;
+  stage->busy_time += busy_time;
+  g_mutex_unlock (&stage->lock);
+}
+
+static void
+item_free (Item *item)
+{
+  g_object_unref (item->file);
+  g_free (item->dest_path);
+  g_free (item->inverse_path);
+
+  if (item->surface != NULL)
+    cairo_surface_destroy (item->surface);
+  if (item->inverse_surface != NULL)
+    cairo_surface_destroy (item->inverse_surface);
+
+  g_slice_free (Item, item);
+}
+
+/* Strokes the outline around @region in @grey and paints @glyph over it */
+static cairo_surface_t *
+compose_icon (cairo_surface_t *glyph,
+              cairo_region_t  *region,
+              gint             icon_size,
+              gint             border_offset,
+              gdouble          grey)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                        icon_size, icon_size);
+  cr = cairo_create (surface);
+
+  cairo_save (cr);
+  gdk_cairo_region (cr, region);
+
+  cairo_set_source_rgba (cr, grey, grey, grey, 1.0);
+  cairo_set_line_width (cr, 2.0 * border_offset);
+  cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+  cairo_set_line_join (cr, CAIRO_LINE_JOIN_ROUND);
+
+  cairo_stroke (cr);
+  cairo_restore (cr);
+
+  cairo_set_source_surface (cr, glyph, 0, 0);
+  cairo_paint (cr);
+
+  cairo_destroy (cr);
+
+  return surface;
+}
+
+/* Renders @item, and its inverse if it has an inverse path. The
+ * inverse is composited from the inverted glyphs and a black outline
+ * rather than inverted afterwards, so the edges between a status colour
+ * and the outline blend with black instead of keeping the white.
+ */
+static gboolean
+render_icon (Item   *item,
+             gint64 *invert_time)
+{
+  RsvgHandle *handle;
+  gint border_offset, glyph_size;
+  cairo_surface_t *glyph;
+  cairo_region_t *region;
+  cairo_t *cr;
+  gint64 start;
+
+  border_offset = (gint) floor (item->icon_size / 16);
+  glyph_size = item->icon_size - 2 * border_offset;
+  handle = get_recolored_svg (item->file);
+
+  if (handle == NULL)
+    return FALSE;
+
+  glyph = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                      item->icon_size, item->icon_size);
+  cr = cairo_create (glyph);
+
+  /* the wrapping SVG is 16x16 */
+  cairo_translate (cr, border_offset, border_offset);
+  cairo_scale (cr, glyph_size / 16.0, glyph_size / 16.0);
+  rsvg_handle_render_cairo (handle, cr);
+  cairo_destroy (cr);
+  g_object_unref (handle);
+
+  region = _gdk_cairo_region_create_from_surface (glyph);
+
+  item->surface = compose_icon (glyph, region, item->icon_size,
+                                border_offset, 1.0);
+
+  if (item->inverse_path != NULL)
+    {
+      start = g_get_monotonic_time ();
+      highcontrast_invert_surface (glyph);
+      *invert_time += g_get_monotonic_time () - start;
+
+      item->inverse_surface = compose_icon (glyph, region, item->icon_size,
+                                            border_offset, 0.0);
+    }
+
+  cairo_region_destroy (region);
+  cairo_surface_destroy (glyph);
+
+  return TRUE;
+}
+
+static gpointer
+render_thread_func (gpointer data)
+{
+  Item *item;
+  guint n_items = 0, n_inverted = 0;
+  gint64 start, busy_time = 0, invert_time = 0;
+
+  while ((item = bounded_queue_pop (&render_queue)) != NULL)
+    {
+      start = g_get_monotonic_time ();
+      if (!render_icon (item, &invert_time))
+        {
+          g_printerr ("Unable to render %s\n", item->dest_path);
+          item_free (item);
+          continue;
+        }
+      busy_time += g_get_monotonic_time () - start;
+      n_items++;
+
+      if (item->inverse_surface != NULL)
+        n_inverted++;
+
+      bounded_queue_push (&write_queue, item);
+    }
+
+  stage_add (&render_stage, n_items, busy_time);
+  stage_add (&invert_stage, n_inverted, invert_time);
+
+  /* the last renderer to finish lets the writers know there's no more */
+  if (g_atomic_int_dec_and_test (&renderers_running))
+    bounded_queue_close (&write_queue);
+
+  return NULL;
+}
+
+static void
+write_png (cairo_surface_t *surface,
+           const gchar     *path)
+{
+  if (cairo_surface_write_to_png (surface, path) == CAIRO_STATUS_SUCCESS)
+    optimize_png (path);
+  else
+    g_printerr ("Unable to write %s\n", path);
+}
+
+static gpointer
+write_thread_func (gpointer data)
+{
+  Item *item;
+  guint n_items = 0;
+  gint64 start, busy_time = 0;
+
+  while ((item = bounded_queue_pop (&write_queue)) != NULL)
+    {
+      start = g_get_monotonic_time ();
+      write_png (item->surface, item->dest_path);
+
+      if (item->inverse_surface != NULL)
+        write_png (item->inverse_surface, item->inverse_path);
+
+      busy_time += g_get_monotonic_time () - start;
+      n_items++;
+      item_free (item);
+    }
+
+  stage_add (&write_stage, n_items, busy_time);
+
+  return NULL;
+}
+
+static void
+ensure_dir (const gchar *path,
+            GHashTable  *created_dirs)
+{
+  gchar *dir;
+
+  dir = g_path_get_dirname (path);
+
+  if (!g_hash_table_contains (created_dirs, dir))
+    {
+      g_mkdir_with_parents (dir, 0755);
+      g_hash_table_add (created_dirs, dir);
+    }
+  else
+    {
+      g_free (dir);
+    }
+}
+
+/* Queues an item for every size of @file, creating each destination
+ * directory the first time it's needed.
+ */
+static void
+queue_svg (GFile      *file,
+           GHashTable *created_dirs)
+{
+  gchar *relative_path, *png_path, *size_string, *dest_relative;
+  GFile *dest_file;
+  Item *item;
   gint idx;
 
-  str = g_get_current_dir ();
-  current_dir = g_file_new_for_path (str);
-  g_free (str);
+  relative_path = g_file_get_relative_path (gnome_dir, file);
+  png_path = replace_str (relative_path, "-symbolic.svg", ".png");
 
-  symbolic_theme = g_file_new_for_commandline_arg (argv[1]);
-  gnome_dir = g_file_resolve_relative_path (symbolic_theme, "gnome");
-  hc_dir = g_file_resolve_relative_path (current_dir, "icons");
-  g_object_unref (symbolic_theme);
+  for (idx = 0; idx < G_N_ELEMENTS (icon_sizes); idx++)
+    {
+      size_string = g_strdup_printf ("%dx%d", icon_sizes[idx], icon_sizes[idx]);
+      dest_relative = replace_str (png_path, "scalable", size_string);
+
+      item = g_slice_new0 (Item);
+      item->file = g_object_ref (file);
+      item->icon_size = icon_sizes[idx];
+      dest_file = g_file_resolve_relative_path (hc_dir, dest_relative);
+      item->dest_path = g_file_get_path (dest_file);
+      g_object_unref (dest_file);
+      ensure_dir (item->dest_path, created_dirs);
+
+      if (inverse_dir != NULL)
+        {
+          dest_file = g_file_resolve_relative_path (inverse_dir, dest_relative);
+          item->inverse_path = g_file_get_path (dest_file);
+          g_object_unref (dest_file);
+          ensure_dir (item->inverse_path, created_dirs);
+        }
+
+      bounded_queue_push (&render_queue, item);
 
+      g_free (size_string);
+      g_free (dest_relative);
+    }
+
+  g_free (relative_path);
+  g_free (png_path);
+}
+
+/* Walks the symbolic theme, only looking at the file names: the type
+ * is all that's needed to recurse, and the SVGs are told by their
+ * extension, which saves sniffing the content of every file.
+ */
+static void
+scan (void)
+{
+  GHashTable *created_dirs;
+  GQueue *descend_into_files;
+  GFile *file, *child;
+  GFileInfo *child_info;
+  GFileEnumerator *enumerator;
+  const gchar *name;
+  guint n_items = 0;
+  gint64 start, busy_time = 0;
+
+  created_dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   descend_into_files = g_queue_new ();
   g_queue_push_tail (descend_into_files, g_object_ref (gnome_dir));
+
+  start = g_get_monotonic_time ();
+
   while ((file = g_queue_pop_head (descend_into_files)) != NULL)
     {
-      GFileInfo *child_info;
-      GFileEnumerator *enumerator = 
-        g_file_enumerate_children (file, "standard::name,standard::type,standard::content-type", 
-                                   G_FILE_QUERY_INFO_NONE, NULL, NULL);
+      enumerator = g_file_enumerate_children (file, "standard::name,standard::type",
+                                              G_FILE_QUERY_INFO_NONE, NULL, NULL);
 
-      while ((child_info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+      while (enumerator != NULL &&
+             (child_info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
         {
+          name = g_file_info_get_name (child_info);
+
           if (g_file_info_get_file_type (child_info) == G_FILE_TYPE_DIRECTORY)
-            g_queue_push_tail (descend_into_files, g_file_resolve_relative_path (file, g_file_info_get_name (child_info)));
-          else if (g_content_type_is_a (g_file_info_get_content_type (child_info), "image/svg+xml"))
-            svg_files = g_list_prepend (svg_files, g_file_resolve_relative_path (file, g_file_info_get_name (child_info)));
+            {
+              g_queue_push_tail (descend_into_files, g_file_get_child (file, name));
+            }
+          else if (g_str_has_suffix (name, ".svg"))
+            {
+              child = g_file_get_child (file, name);
+
+              /* don't count the time blocked on a full queue */
+              busy_time += g_get_monotonic_time () - start;
+              queue_svg (child, created_dirs);
+              start = g_get_monotonic_time ();
+
+              n_items += G_N_ELEMENTS (icon_sizes);
+              g_object_unref (child);
+            }
 
           g_object_unref (child_info);
         }
 
-      g_object_unref (enumerator);
+      g_clear_object (&enumerator);
       g_object_unref (file);
     }
 
-  for (idx = 0; idx < G_N_ELEMENTS (icon_sizes); idx++)
-    write_png_theme (svg_files, icon_sizes[idx]);
+  busy_time += g_get_monotonic_time () - start;
+  stage_add (&scan_stage, n_items, busy_time);
+
+  bounded_queue_close (&render_queue);
 
-  g_list_free_full (svg_files, g_object_unref);
   g_queue_free (descend_into_files);
+  g_hash_table_destroy (created_dirs);
+}
+
+static gint
+get_n_processors (void)
+{
+#if GLIB_CHECK_VERSION (2, 36, 0)
+  return g_get_num_processors ();
+#else
+  return MAX (sysconf (_SC_NPROCESSORS_ONLN), 1);
+#endif
+}
+
+static void
+print_stage (const Stage *stage,
+             gint64       wall_time)
+{
+  g_print ("%-8s %7d %8u %10.2f %12.1f\n",
+           stage->name, stage->n_threads, stage->n_items,
+           stage->busy_time / 1000000.0,
+           stage->n_items / MAX (wall_time / 1000000.0, 1e-6));
+}
+
+static void
+print_queue (const gchar        *name,
+             const BoundedQueue *queue)
+{
+  g_print ("%-8s %8u %10.1f %8u %10.2f %10.2f\n",
+           name, queue->capacity,
+           queue->n_pushed ? (gdouble) queue->occupancy_sum / queue->n_pushed : 0.0,
+           queue->max_occupancy,
+           queue->full_time / 1000000.0,
+           queue->empty_time / 1000000.0);
+}
+
+static void
+process (int argc,
+         char **argv)
+{
+  GFile *current_dir, *symbolic_theme;
+  GThread **renderers, **writers;
+  gint64 start, wall_time;
+  gchar *str;
+  gint idx;
+
+  str = g_get_current_dir ();
+  current_dir = g_file_new_for_path (str);
+  g_free (str);
+
+  symbolic_theme = g_file_new_for_commandline_arg (argv[1]);
+  gnome_dir = g_file_resolve_relative_path (symbolic_theme, "gnome");
+  hc_dir = g_file_resolve_relative_path (current_dir, "icons");
+  g_object_unref (symbolic_theme);
+
+  if (inverse_theme != NULL)
+    {
+      str = g_build_filename (inverse_theme, "icons", NULL);
+      inverse_dir = g_file_resolve_relative_path (current_dir, str);
+      g_free (str);
+    }
+  g_object_unref (current_dir);
+
+  if (n_renderers <= 0)
+    n_renderers = get_n_processors ();
+  n_writers = MAX (n_writers, 1);
+
+  render_stage.n_threads = n_renderers;
+  write_stage.n_threads = n_writers;
+  invert_stage.n_threads = n_renderers;
+  renderers_running = n_renderers;
+
+  bounded_queue_init (&render_queue, QUEUE_CAPACITY);
+  bounded_queue_init (&write_queue, QUEUE_CAPACITY);
+
+  start = g_get_monotonic_time ();
+
+  renderers = g_new (GThread *, n_renderers);
+  for (idx = 0; idx < n_renderers; idx++)
+    renderers[idx] = g_thread_new ("render", render_thread_func, NULL);
+
+  writers = g_new (GThread *, n_writers);
+  for (idx = 0; idx < n_writers; idx++)
+    writers[idx] = g_thread_new ("write", write_thread_func, NULL);
+
+  /* rendering starts as soon as the first item is queued */
+  scan ();
+
+  for (idx = 0; idx < n_renderers; idx++)
+    g_thread_join (renderers[idx]);
+  for (idx = 0; idx < n_writers; idx++)
+    g_thread_join (writers[idx]);
+
+  wall_time = g_get_monotonic_time () - start;
+
+  g_print ("%u icons written in %.2f s\n",
+           write_stage.n_items, wall_time / 1000000.0);
+  g_print ("%-8s %7s %8s %10s %12s\n",
+           "stage", "threads", "items", "busy (s)", "items/s");
+  print_stage (&scan_stage, wall_time);
+  print_stage (&parse_stage, wall_time);
+  print_stage (&render_stage, wall_time);
+  print_stage (&write_stage, wall_time);
+  if (inverse_dir != NULL)
+    print_stage (&invert_stage, wall_time);
+  g_print ("renderers waited %.2f s for the SVG parser\n",
+           svg_lock_wait_time / 1000000.0);
+  g_print ("%-8s %8s %10s %8s %10s %10s\n",
+           "queue", "capacity", "mean", "max", "full (s)", "empty (s)");
+  print_queue ("render", &render_queue);
+  print_queue ("write", &write_queue);
+
+  bounded_queue_clear (&render_queue);
+  bounded_queue_clear (&write_queue);
+  g_free (renderers);
+  g_free (writers);
   g_clear_object (&gnome_dir);
   g_clear_object (&hc_dir);
+  g_clear_object (&inverse_dir);
 }
 
 int
 main (int argc,
       char **argv)
 {
+  GOptionContext *context;
+  GError *error = NULL;
+
+  g_type_init ();
+
+  context = g_option_context_new ("SYMBOLIC-THEME-DIR - render the HighContrast icons");
+  g_option_context_add_main_entries (context, entries, NULL);
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+
+  g_option_context_free (context);
+
   if (argc == 1)
     {
       g_critical ("Location of gnome-icon-theme-symbolic repo must be given");
       return 0;
     }
 
-  g_type_init ();
   process (argc, argv);
   g_spawn_command_line_async ("./create-makefiles.sh", NULL);
 
+  if (inverse_theme != NULL)
+    {
+      gchar *quoted, *cmd;
+
+      quoted = g_shell_quote (inverse_theme);
+      cmd = g_strconcat ("./create-makefiles.sh ", quoted, NULL);
+      g_spawn_command_line_async (cmd, NULL);
+      g_free (quoted);
+      g_free (cmd);
+    }
+
   return 0;
 }
@@ -1,8 +1,19 @@
 #!/bin/bash
 
+# Lists the icons of the theme in the given directory, the current one by
+# default, for distribution.
+cd "${1:-.}" || exit 1
+
 FILE=Makefile-icons.am
 
 echo "NULL=" > $FILE
 echo "EXTRA_DIST = \\" >> $FILE
-find . \( -name "*.png" -or -name "*.svg" \) -print | awk '{ print $$0, " \\" }' >> $FILE
+# Directories with a Makefile.am installing their own icons already
+# distribute them, so they're left out rather than listed twice.
+PRUNE=
+for makefile in `find . -mindepth 2 -name Makefile.am`; do
+	grep -q "^icon_DATA" $makefile && PRUNE="$PRUNE -path `dirname $makefile` -prune -o"
+done
+
+find . $PRUNE \( -name "*.png" -or -name "*.svg" \) -print | awk '{ print $$0, " \\" }' >> $FILE
 echo "\$(NULL)" >> $FILE
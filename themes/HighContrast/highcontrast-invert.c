@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include "highcontrast-invert.h"
+
+/* The inverse theme is made by swapping black and white. It's applied
+ * to the glyph layer of an icon only, before that is composited over
+ * the inverted outline: the glyphs are black plus the warning, error
+ * and success colours over transparency, so every grey pixel gets
+ * inverted and every other one is left alone, and no pixel mixes a
+ * status colour with the outline. On premultiplied pixels, inverting a
+ * channel is just subtracting it from the alpha, which can't borrow
+ * from the next channel since no channel is larger than the alpha.
+ *
+ * Nearly transparent pixels are left alone: premultiplying rounds
+ * every channel to one of alpha + 1 levels, so at alpha 1 the status
+ * colours come out as 0x01000000, which looks like black, and would
+ * turn white. A colour whose channels differ by d keeps them apart
+ * from an alpha of 255 / d; from MIN_ALPHA on, that holds for anything
+ * with channels 32 or more apart, which the status colours are by far.
+ * Leaving the faintest edge of a grey glyph uninverted can't be seen.
+ *
+ * This is the reference the vector version is checked against.
+ */
+#define MIN_ALPHA 8
+
+guint32
+highcontrast_invert_pixel (guint32 pixel)
+{
+  guint32 alpha = pixel >> 24;
+
+  if (alpha < MIN_ALPHA || ((pixel ^ (pixel >> 8)) & 0xffff) != 0)
+    return pixel;
+
+  return (pixel & 0xff000000) | (alpha * 0x010101 - (pixel & 0x00ffffff));
+}
+
+#if defined (__clang__) || (defined (__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define HAVE_VECTOR_EXTENSIONS 1
+
+/* four pixels, which maps to SSE2 or NEON registers */
+typedef guint32 PixelVector __attribute__ ((vector_size (16)));
+#endif
+
+void
+highcontrast_invert_row (guint32 *row,
+                         gint     width)
+{
+  gint x = 0;
+
+#ifdef HAVE_VECTOR_EXTENSIONS
+  PixelVector pixels, grey, inverted;
+
+  for (; x + 4 <= width; x += 4)
+    {
+      memcpy (&pixels, row + x, sizeof (PixelVector));
+
+      inverted = (pixels & 0xff000000) | ((pixels >> 24) * 0x010101 - (pixels & 0x00ffffff));
+      grey = (PixelVector) ((((pixels ^ (pixels >> 8)) & 0xffff) == 0) &
+                            ((pixels >> 24) >= MIN_ALPHA));
+      pixels = (inverted & grey) | (pixels & ~grey);
+
+      memcpy (row + x, &pixels, sizeof (PixelVector));
+    }
+#endif
+
+  for (; x < width; x++)
+    row[x] = highcontrast_invert_pixel (row[x]);
+}
+
+void
+highcontrast_invert_surface (cairo_surface_t *surface)
+{
+  guchar *data;
+  gint y, width, height, stride;
+
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  for (y = 0; y < height; y++)
+    highcontrast_invert_row ((guint32 *) (data + y * stride), width);
+
+  cairo_surface_mark_dirty (surface);
+}
@@ -0,0 +1,17 @@
+#ifndef __HIGHCONTRAST_INVERT_H__
+#define __HIGHCONTRAST_INVERT_H__
+
+#include <cairo/cairo.h>
+#include <glib.h>
+
+guint32
+highcontrast_invert_pixel (guint32 pixel);
+
+void
+highcontrast_invert_row (guint32 *row,
+                         gint     width);
+
+void
+highcontrast_invert_surface (cairo_surface_t *surface);
+
+#endif /* __HIGHCONTRAST_INVERT_H__ */
@@ -0,0 +1,170 @@
+#include <string.h>
+
+#include "highcontrast-invert.h"
+
+static const guint32 status_colors[] = {
+  0xf57900, /* warning */
+  0xcc0000, /* error */
+  0x4e9a06  /* success */
+};
+
+/* Checks highcontrast_invert_row() against highcontrast_invert_pixel()
+ * on random premultiplied pixels, at every alignment and with every
+ * kind of remainder, and that it keeps the properties the inverse
+ * theme relies on.
+ */
+static gint
+check_row (void)
+{
+  guint32 pixels[67], expected[67], original[67];
+  guint32 alpha, color, channel;
+  GRand *rand;
+  gint width, offset, i, n_failures = 0;
+  guint x;
+  gboolean inside;
+
+  rand = g_rand_new_with_seed (42);
+
+  for (i = 0; i < 1000; i++)
+    {
+      for (x = 0; x < G_N_ELEMENTS (pixels); x++)
+        {
+          alpha = g_rand_int_range (rand, 0, 256);
+
+          switch (g_rand_int_range (rand, 0, 3))
+            {
+            case 0:
+              channel = g_rand_int_range (rand, 0, alpha + 1);
+              color = channel * 0x010101;
+              break;
+            case 1:
+              color = status_colors[g_rand_int_range (rand, 0, G_N_ELEMENTS (status_colors))];
+              color = (((color >> 16) & 0xff) * alpha / 255) << 16 |
+                      (((color >> 8) & 0xff) * alpha / 255) << 8 |
+                      ((color & 0xff) * alpha / 255);
+              break;
+            default:
+              color = g_rand_int_range (rand, 0, alpha + 1) << 16 |
+                      g_rand_int_range (rand, 0, alpha + 1) << 8 |
+                      g_rand_int_range (rand, 0, alpha + 1);
+              break;
+            }
+
+          original[x] = (alpha << 24) | color;
+        }
+
+      width = g_rand_int_range (rand, 0, G_N_ELEMENTS (pixels));
+      offset = g_rand_int_range (rand, 0, G_N_ELEMENTS (pixels) - width + 1);
+
+      memcpy (pixels, original, sizeof (pixels));
+      highcontrast_invert_row (pixels + offset, width);
+
+      for (x = 0; x < G_N_ELEMENTS (pixels); x++)
+        {
+          inside = (gint) x >= offset && (gint) x < offset + width;
+          expected[x] = inside ? highcontrast_invert_pixel (original[x]) : original[x];
+
+          /* inverting keeps the alpha and is its own inverse */
+          if (pixels[x] != expected[x] ||
+              (pixels[x] >> 24) != (original[x] >> 24) ||
+              (inside && highcontrast_invert_pixel (pixels[x]) != original[x]))
+            {
+              if (n_failures++ < 10)
+                g_printerr ("Pixel %d of %d at %d: %08x inverted to %08x, expected %08x\n",
+                            (gint) x - offset, width, offset,
+                            original[x], pixels[x], expected[x]);
+            }
+        }
+    }
+
+  g_rand_free (rand);
+
+  /* the status colours stay, black and white swap */
+  for (x = 0; x < G_N_ELEMENTS (status_colors); x++)
+    if (highcontrast_invert_pixel (0xff000000 | status_colors[x]) != (0xff000000 | status_colors[x]))
+      n_failures++;
+
+  if (highcontrast_invert_pixel (0xff000000) != 0xffffffff ||
+      highcontrast_invert_pixel (0xffffffff) != 0xff000000 ||
+      highcontrast_invert_pixel (0x00000000) != 0x00000000)
+    n_failures++;
+
+  /* a status colour that premultiplied to black stays, in both paths */
+  for (x = 0; x < 5; x++)
+    pixels[x] = 0x01000000;
+  highcontrast_invert_row (pixels, 5);
+  for (x = 0; x < 5; x++)
+    if (pixels[x] != 0x01000000)
+      n_failures++;
+
+  return n_failures;
+}
+
+/* Checks that the anti-aliased edge of a status colour, once the glyph
+ * layer is inverted and composited over the black outline of the
+ * inverse theme, is never lighter than the status colour itself.
+ */
+static gint
+check_edges (void)
+{
+  cairo_surface_t *glyph, *icon;
+  cairo_t *cr;
+  guint32 pixel, status;
+  gint i, shift, n_failures = 0;
+  guint x;
+
+  for (x = 0; x < G_N_ELEMENTS (status_colors); x++)
+    for (i = 1; i < 255; i++)
+      {
+        status = status_colors[x];
+
+        glyph = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+        cr = cairo_create (glyph);
+        cairo_set_source_rgba (cr,
+                               ((status >> 16) & 0xff) / 255.,
+                               ((status >> 8) & 0xff) / 255.,
+                               (status & 0xff) / 255.,
+                               i / 255.);
+        cairo_paint (cr);
+        cairo_destroy (cr);
+
+        highcontrast_invert_surface (glyph);
+
+        icon = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+        cr = cairo_create (icon);
+        cairo_set_source_rgb (cr, 0, 0, 0);
+        cairo_paint (cr);
+        cairo_set_source_surface (cr, glyph, 0, 0);
+        cairo_paint (cr);
+        cairo_destroy (cr);
+
+        cairo_surface_flush (icon);
+        pixel = *(guint32 *) cairo_image_surface_get_data (icon);
+
+        for (shift = 0; shift < 24; shift += 8)
+          if (((pixel >> shift) & 0xff) > ((status >> shift) & 0xff))
+            {
+              if (n_failures++ < 10)
+                g_printerr ("%06x at alpha %d composited to %08x\n",
+                            status, i, pixel);
+              break;
+            }
+
+        cairo_surface_destroy (icon);
+        cairo_surface_destroy (glyph);
+      }
+
+  return n_failures;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  gint n_failures;
+
+  n_failures = check_row ();
+  n_failures += check_edges ();
+
+  return n_failures == 0 ? 0 : 1;
+}
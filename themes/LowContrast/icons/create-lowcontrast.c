@@ -0,0 +1,168 @@
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+/* LowContrast is drawn at 48x48 only. Without smaller versions, every
+ * menu or toolbar lookup loads the 48x48 image and scales it down in
+ * each process, and GTK+ keeps the scaled copies around. This renders
+ * the menu and toolbar sizes once, from the 48x48 images, when the
+ * theme is built.
+ */
+static const gint icon_sizes[] = {
+  16, 22, 24, 32
+};
+
+#define SOURCE_SIZE "48x48"
+#define SOURCE_PIXELS 48
+
+/* a partial set would let the build pass with icons missing */
+static guint n_failures = 0;
+
+/* On reduction, gdk-pixbuf's bilinear filter averages the whole source
+ * area of each destination pixel, weighting the colours by their
+ * alpha, so the 3:1 reduction to 16x16 doesn't alias.
+ *
+ * A few 48x48 images are smaller than 48 pixels, e.g. the 24x24
+ * media-playback-pause.png and the 32x32 gtk-dnd.png. GTK+ scales those
+ * by the same factor as the full-size ones, so they keep their
+ * proportion here rather than being stretched to @icon_size: at 16x16
+ * they are 8x8 and 11x11 on purpose.
+ */
+static gboolean
+scale_icon (GdkPixbuf   *source,
+            gint         icon_size,
+            const gchar *dest_path)
+{
+  GdkPixbuf *pixbuf;
+  GError *error = NULL;
+  gboolean retval;
+  gint width, height;
+
+  width = MAX (1, (gdk_pixbuf_get_width (source) * icon_size + SOURCE_PIXELS / 2) / SOURCE_PIXELS);
+  height = MAX (1, (gdk_pixbuf_get_height (source) * icon_size + SOURCE_PIXELS / 2) / SOURCE_PIXELS);
+
+  pixbuf = gdk_pixbuf_scale_simple (source, width, height,
+                                    GDK_INTERP_BILINEAR);
+
+  retval = gdk_pixbuf_save (pixbuf, dest_path, "png", &error, NULL);
+
+  if (!retval)
+    {
+      g_printerr ("Unable to write %s: %s\n", dest_path, error->message);
+      g_error_free (error);
+    }
+
+  g_object_unref (pixbuf);
+
+  return retval;
+}
+
+static guint
+process_context (const gchar *source_icons_dir,
+                 const gchar *dest_icons_dir,
+                 const gchar *context)
+{
+  GdkPixbuf *source;
+  GError *error = NULL;
+  GDir *dir;
+  const gchar *name;
+  gchar *source_dir, *source_path, *size_string, *dest_dir, *dest_path;
+  guint n_written = 0;
+  guint idx;
+
+  source_dir = g_build_filename (source_icons_dir, SOURCE_SIZE, context, NULL);
+  dir = g_dir_open (source_dir, 0, NULL);
+
+  while (dir != NULL && (name = g_dir_read_name (dir)) != NULL)
+    {
+      if (!g_str_has_suffix (name, ".png"))
+        continue;
+
+      source_path = g_build_filename (source_dir, name, NULL);
+      source = gdk_pixbuf_new_from_file (source_path, &error);
+
+      if (source == NULL)
+        {
+          g_printerr ("Unable to load %s: %s\n", source_path, error->message);
+          g_clear_error (&error);
+          n_failures++;
+          g_free (source_path);
+          continue;
+        }
+
+      for (idx = 0; idx < G_N_ELEMENTS (icon_sizes); idx++)
+        {
+          size_string = g_strdup_printf ("%dx%d", icon_sizes[idx], icon_sizes[idx]);
+          dest_dir = g_build_filename (dest_icons_dir, size_string, context, NULL);
+          dest_path = g_build_filename (dest_dir, name, NULL);
+
+          g_mkdir_with_parents (dest_dir, 0755);
+
+          if (scale_icon (source, icon_sizes[idx], dest_path))
+            n_written++;
+          else
+            n_failures++;
+
+          g_free (size_string);
+          g_free (dest_dir);
+          g_free (dest_path);
+        }
+
+      g_object_unref (source);
+      g_free (source_path);
+    }
+
+  if (dir != NULL)
+    g_dir_close (dir);
+
+  g_free (source_dir);
+
+  return n_written;
+}
+
+int
+main (int argc,
+      char **argv)
+{
+  GDir *dir;
+  const gchar *context;
+  gchar *source_dir;
+  guint n_written = 0;
+
+  g_type_init ();
+
+  if (argc != 3)
+    {
+      g_printerr ("Usage: %s SOURCE-ICONS-DIR DEST-ICONS-DIR\n", argv[0]);
+      return 1;
+    }
+
+  /* every context drawn at 48x48 gets the smaller sizes */
+  source_dir = g_build_filename (argv[1], SOURCE_SIZE, NULL);
+  dir = g_dir_open (source_dir, 0, NULL);
+
+  if (dir == NULL)
+    {
+      g_printerr ("No %s icons in %s\n", SOURCE_SIZE, argv[1]);
+      g_free (source_dir);
+      return 1;
+    }
+
+  while ((context = g_dir_read_name (dir)) != NULL)
+    {
+      gchar *path = g_build_filename (source_dir, context, NULL);
+
+      if (g_file_test (path, G_FILE_TEST_IS_DIR))
+        n_written += process_context (argv[1], argv[2], context);
+
+      g_free (path);
+    }
+
+  g_dir_close (dir);
+  g_free (source_dir);
+
+  g_print ("%u icons written\n", n_written);
+
+  return n_failures == 0 ? 0 : 1;
+}